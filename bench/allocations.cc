@@ -0,0 +1,127 @@
+/**
+ * Heap allocations per prediction and per sentence vector once every
+ * thread buffer has grown, counted by replacing the global operator new.
+ *
+ *   ./allocations model.bin sentences.txt
+ *
+ * Exits with 1 when the steady state paths allocate.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "wrapper.h"
+
+namespace {
+
+std::atomic<int64_t> allocations(0);
+
+constexpr int32_t ROUNDS = 100;
+constexpr int32_t K = 2;
+
+void* allocate(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size > 0 ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+template <typename F>
+double perCall(int64_t calls, F op) {
+  int64_t before = allocations.load();
+  op();
+  return double(allocations.load() - before) / calls;
+}
+
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size > 0 ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size > 0 ? size : 1);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: %s model.bin sentences.txt\n", argv[0]);
+    return 2;
+  }
+  std::vector<std::string> lines;
+  std::ifstream in(argv[2]);
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(line);
+  }
+  if (lines.empty()) {
+    std::fprintf(stderr, "no sentences in %s\n", argv[2]);
+    return 2;
+  }
+
+  Wrapper wrapper(argv[1]);
+  wrapper.warmUp(true);
+  const int64_t calls = (int64_t) ROUNDS * lines.size();
+  std::vector<PredictResult> predictions;
+  std::vector<real> vector(wrapper.getDimension());
+
+  // first round: the thread buffers grow to the largest line
+  bool supervised = true;
+  for (const std::string& s : lines) {
+    try {
+      wrapper.predict(s.data(), s.size(), K, predictions);
+    } catch (const std::invalid_argument&) {
+      // word vectors only
+      supervised = false;
+    }
+    wrapper.getSentenceVector(s.data(), s.size(), vector.data());
+  }
+
+  std::printf("%-28s %12s\n", "path", "allocs/call");
+  double sentenceVector = perCall(calls, [&] {
+    for (int32_t r = 0; r < ROUNDS; r++) {
+      for (const std::string& s : lines) {
+        wrapper.getSentenceVector(s.data(), s.size(), vector.data());
+      }
+    }
+  });
+  std::printf("%-28s %12.3f\n", "sentence vector into buffer", sentenceVector);
+  if (!supervised) {
+    return sentenceVector == 0 ? 0 : 1;
+  }
+
+  double predict = perCall(calls, [&] {
+    for (int32_t r = 0; r < ROUNDS; r++) {
+      for (const std::string& s : lines) {
+        wrapper.predict(s.data(), s.size(), K, predictions);
+      }
+    }
+  });
+  // for reference: a fresh result per call, as the JS callbacks get
+  double predictCopy = perCall(calls, [&] {
+    for (int32_t r = 0; r < ROUNDS; r++) {
+      for (const std::string& s : lines) {
+        wrapper.predict(s, K);
+      }
+    }
+  });
+
+  std::printf("%-28s %12.3f\n", "predict into buffer", predict);
+  std::printf("%-28s %12.3f\n", "predict returning a vector", predictCopy);
+  return predict == 0 && sentenceVector == 0 ? 0 : 1;
+}
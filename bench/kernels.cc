@@ -0,0 +1,81 @@
+/**
+ * Per-dimension cost of the Vector/Matrix inner loops for every kernel set
+ * this CPU supports, compared to the scalar loop.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "kernels.h"
+
+using fasttext::KernelSet;
+using fasttext::real;
+
+namespace {
+
+// a hidden layer sized block of rows, small enough to stay in L1/L2
+constexpr int64_t ROWS = 256;
+
+template <typename F>
+double nsPerDim(int64_t dim, F op) {
+  int64_t reps = 1;
+  double elapsed = 0;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t r = 0; r < reps; r++) {
+      for (int64_t i = 0; i < ROWS; i++) {
+        op(i);
+      }
+    }
+    elapsed = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+    if (elapsed > 2e8) {
+      break;
+    }
+    reps *= 2;
+  }
+  return elapsed / (reps * ROWS * dim);
+}
+
+}
+
+int main() {
+  std::vector<const KernelSet*> sets = fasttext::kernels::supported();
+  std::minstd_rand rng(1);
+  std::uniform_real_distribution<real> uniform(-1, 1);
+  volatile real sink = 0;
+
+  std::printf("active kernels: %s\n\n", fasttext::kernels::active()->name);
+  std::printf("%-6s %-8s %12s %12s %12s\n", "dim", "kernels",
+              "add ns/dim", "axpy ns/dim", "dot ns/dim");
+
+  for (int64_t dim : {16, 50, 100, 200, 300}) {
+    std::vector<real> matrix(ROWS * dim), vec(dim);
+    for (auto& v : matrix) v = uniform(rng);
+    for (auto& v : vec) v = uniform(rng);
+
+    double base[3] = {0, 0, 0};
+    for (const KernelSet* k : sets) {
+      double add = nsPerDim(dim, [&](int64_t i) {
+        k->add(vec.data(), matrix.data() + i * dim, dim);
+      });
+      double axpy = nsPerDim(dim, [&](int64_t i) {
+        k->axpy(vec.data(), matrix.data() + i * dim, 1e-6, dim);
+      });
+      double dot = nsPerDim(dim, [&](int64_t i) {
+        sink = sink + k->dot(matrix.data() + i * dim, vec.data(), dim);
+      });
+      if (k == sets.front()) {
+        base[0] = add;
+        base[1] = axpy;
+        base[2] = dot;
+      }
+      std::printf("%-6lld %-8s %6.3f (%3.1fx) %6.3f (%3.1fx) %6.3f (%3.1fx)\n",
+                  (long long) dim, k->name,
+                  add, base[0] / add, axpy, base[1] / axpy, dot, base[2] / dot);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * Concurrent inference stress test, meant to run under ThreadSanitizer
+ * (`make tsan`): many threads predict, embed and search on one wrapper
+ * from its first, lazy load on, while the cache and batching settings
+ * change under them. Every result must equal the one computed alone.
+ *
+ *   ./stress model.bin sentences.txt [threads] [rounds]
+ *
+ * Exits with 1 on any mismatch.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wrapper.h"
+
+namespace {
+
+constexpr int32_t K = 2;
+constexpr int32_t NN_K = 5;
+
+struct Expected {
+  std::vector<std::vector<PredictResult>> predictions;
+  std::vector<std::vector<PredictResult>> neighbors;
+  std::vector<real> vectors;
+};
+
+bool same(const std::vector<PredictResult>& a,
+          const std::vector<PredictResult>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].label != b[i].label || a[i].value != b[i].value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the last word of a sentence, as an nn query: labels come first
+std::string lastWord(const std::string& s) {
+  size_t to = s.find_last_not_of(" \t\r");
+  if (to == std::string::npos) {
+    return "";
+  }
+  size_t from = s.find_last_of(" \t", to);
+  from = from == std::string::npos ? 0 : from + 1;
+  return s.substr(from, to + 1 - from);
+}
+
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: %s model.bin sentences.txt [threads] [rounds]\n",
+                 argv[0]);
+    return 2;
+  }
+  int32_t threads = argc > 3 ? std::atoi(argv[3]) : 8;
+  int32_t rounds = argc > 4 ? std::atoi(argv[4]) : 20;
+  std::vector<std::string> lines;
+  std::ifstream in(argv[2]);
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(line);
+  }
+  if (lines.empty()) {
+    std::fprintf(stderr, "no sentences in %s\n", argv[2]);
+    return 2;
+  }
+
+  // computed alone, on a wrapper of its own
+  Wrapper reference(argv[1]);
+  reference.setSubwordTable(true);
+  reference.loadModel();
+  reference.precomputeSubwords();
+  reference.precomputeWordVectors();
+  const int32_t dim = reference.getDimension();
+  Expected expected;
+  bool supervised = true;
+  for (const std::string& s : lines) {
+    try {
+      expected.predictions.push_back(reference.predict(s, K));
+    } catch (const std::invalid_argument&) {
+      supervised = false;
+    }
+    expected.neighbors.push_back(reference.nn(lastWord(s), NN_K, 1));
+  }
+  expected.vectors.resize((size_t) lines.size() * dim);
+  reference.getSentenceVectors(lines, expected.vectors.data(), 1);
+
+  Wrapper wrapper(argv[1]);
+  wrapper.setSubwordTable(true);
+  std::atomic<int64_t> mismatches(0), requests(0);
+  std::vector<std::thread> workers;
+  for (int32_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::vector<PredictResult> predictions;
+      std::vector<real> vector(dim);
+      for (int32_t r = 0; r < rounds; r++) {
+        for (size_t i = t % lines.size(); i < lines.size(); i += 1 + t) {
+          const std::string& s = lines[i];
+          int64_t bad = 0;
+          // each request does the lazy initialization of its addon worker,
+          // and the threads start with different requests
+          switch ((t + i + r + 1) % 3) {
+            case 0:
+              wrapper.loadModel(false);
+              wrapper.precomputeSubwords();
+              wrapper.precomputeWordVectors();
+              wrapper.getSentenceVector(s.data(), s.size(), vector.data());
+              for (int32_t d = 0; d < dim; d++) {
+                bad += vector[d] != expected.vectors[i * dim + d];
+              }
+              break;
+            case 1:
+              wrapper.loadModel(false);
+              wrapper.precomputeWordVectors();
+              bad += !same(wrapper.nn(lastWord(s), NN_K, 2), expected.neighbors[i]);
+              break;
+            default:
+              if (!supervised) {
+                break;
+              }
+              wrapper.loadModel();
+              wrapper.precomputeSubwords();
+              wrapper.predict(s.data(), s.size(), K, predictions);
+              bad += !same(predictions, expected.predictions[i]);
+              bad += !same(wrapper.predict(s, K), expected.predictions[i]);
+          }
+          if (t == 0 && i % 7 == 0) {
+            // settings change while the other threads are busy
+            wrapper.setCache(r % 2 == 0 ? 1 << 20 : 0);
+            wrapper.setBatching(r % 3 == 0 ? 1 : 8, 100);
+          }
+          if (bad > 0) {
+            mismatches++;
+          }
+          requests++;
+        }
+        if (supervised && t == threads - 1) {
+          wrapper.loadModel();
+          wrapper.precomputeSubwords();
+          std::vector<std::vector<PredictResult>> batch =
+              wrapper.predictBatch(lines, K, 2);
+          for (size_t i = 0; i < lines.size(); i++) {
+            mismatches += !same(batch[i], expected.predictions[i]);
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  std::printf("%d threads, %lld requests, %lld mismatches\n", threads,
+              (long long) requests.load(), (long long) mismatches.load());
+  return mismatches == 0 ? 0 : 1;
+}
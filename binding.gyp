@@ -9,6 +9,12 @@
                 "lib/src/dictionary.h",
                 "lib/src/fasttext.cc",
                 "lib/src/fasttext.h",
+                "lib/src/kernels.cc",
+                "lib/src/kernels.h",
+                "lib/src/mappedfile.cc",
+                "lib/src/mappedfile.h",
+                "lib/src/corpus.cc",
+                "lib/src/corpus.h",
                 "lib/src/matrix.cc",
                 "lib/src/matrix.h",
                 "lib/src/model.cc",
@@ -24,15 +30,51 @@
                 "lib/src/vector.h",
                 "src/nodeArgument.cc",
                 "src/nodeArgument.h",
+                "src/modelObject.h",
                 "src/classifier.h",
                 "src/classifierWorker.cc",
+                "src/classifierBatchWorker.cc",
+                "src/classifierBatchWorker.h",
                 "src/query.h",
                 "src/trainWorker.cc",
                 "src/trainWorker.h",
                 "src/vectorWorker.cc",
                 "src/vectorWorker.h",
+                "src/vectorBatchWorker.cc",
+                "src/vectorBatchWorker.h",
+                "src/float32Array.h",
                 "src/nnWorker.cc",
                 "src/nnWorker.h",
+                "src/hnswIndex.cc",
+                "src/hnswIndex.h",
+                "src/inferenceScratch.cc",
+                "src/inferenceScratch.h",
+                "src/buildIndexWorker.cc",
+                "src/buildIndexWorker.h",
+                "src/evaluateIndexWorker.cc",
+                "src/evaluateIndexWorker.h",
+                "src/loadWorker.cc",
+                "src/loadWorker.h",
+                "src/mappedModel.cc",
+                "src/mappedModel.h",
+                "src/mapModelWorker.cc",
+                "src/mapModelWorker.h",
+                "src/saveModelWorker.cc",
+                "src/saveModelWorker.h",
+                "src/modelRegistry.cc",
+                "src/modelRegistry.h",
+                "src/predictBatcher.cc",
+                "src/predictBatcher.h",
+                "src/predictFileWorker.cc",
+                "src/predictFileWorker.h",
+                "src/predictPipeline.cc",
+                "src/predictPipeline.h",
+                "src/resultCache.cc",
+                "src/resultCache.h",
+                "src/subwordTable.cc",
+                "src/subwordTable.h",
+                "src/workerPool.cc",
+                "src/workerPool.h",
                 "src/wrapper.cc",
                 "src/wrapper.h",
                 "src/fasttext.cc"
@@ -45,7 +87,6 @@
                 "-O3",
                 "-Wsign-compare",
                 "-Wall",
-                "-march=native",
                 "-frtti"
             ],
             "conditions": [
@@ -31,6 +31,8 @@ Args::Args() {
   minn = 3;
   maxn = 6;
   thread = 12;
+  dictThreads = 1;
+  cacheCorpus = false;
   lrUpdateRate = 100;
   t = 1e-4;
   label = "__label__";
@@ -130,6 +132,8 @@ void Args::parseArgs(const std::vector<std::string>& args) {
         maxn = std::stoi(args.at(ai + 1));
       } else if (args[ai] == "-thread") {
         thread = std::stoi(args.at(ai + 1));
+      } else if (args[ai] == "-dictThreads") {
+        dictThreads = std::stoi(args.at(ai + 1));
       } else if (args[ai] == "-t") {
         t = std::stof(args.at(ai + 1));
       } else if (args[ai] == "-label") {
@@ -138,6 +142,9 @@ void Args::parseArgs(const std::vector<std::string>& args) {
         verbose = std::stoi(args.at(ai + 1));
       } else if (args[ai] == "-pretrainedVectors") {
         pretrainedVectors = std::string(args.at(ai + 1));
+      } else if (args[ai] == "-cacheCorpus") {
+        cacheCorpus = true;
+        ai--;
       } else if (args[ai] == "-saveOutput") {
         saveOutput = true;
         ai--;
@@ -201,6 +208,7 @@ void Args::printDictionaryHelp() {
     << "  -bucket             number of buckets [" << bucket << "]\n"
     << "  -minn               min length of char ngram [" << minn << "]\n"
     << "  -maxn               max length of char ngram [" << maxn << "]\n"
+    << "  -dictThreads        number of threads reading the vocabulary [" << dictThreads << "]\n"
     << "  -t                  sampling threshold [" << t << "]\n"
     << "  -label              labels prefix [" << label << "]\n";
 }
@@ -216,6 +224,7 @@ void Args::printTrainingHelp() {
     << "  -neg                number of negatives sampled [" << neg << "]\n"
     << "  -loss               loss function {ns, hs, softmax} [" << lossToString(loss) << "]\n"
     << "  -thread             number of threads [" << thread << "]\n"
+    << "  -cacheCorpus        whether the tokenized input is kept in memory for all epochs [" << boolToString(cacheCorpus) << "]\n"
     << "  -pretrainedVectors  pretrained word vectors for supervised learning ["<< pretrainedVectors <<"]\n"
     << "  -saveOutput         whether output params should be saved [" << boolToString(saveOutput) << "]\n";
 }
@@ -43,6 +43,8 @@ class Args {
     int minn;
     int maxn;
     int thread;
+    int dictThreads;
+    bool cacheCorpus;
     double t;
     std::string label;
     int verbose;
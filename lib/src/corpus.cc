@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "corpus.h"
+
+#include <thread>
+
+#include "dictionary.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace fasttext {
+
+Corpus::Corpus(const std::string& filename) : file_(filename) {
+#ifndef _WIN32
+  if (file_.size() > 0) {
+    // every thread streams through its part: read ahead of it
+    madvise(const_cast<char*>(file_.data()), file_.size(), MADV_SEQUENTIAL);
+  }
+#endif
+}
+
+int64_t Corpus::start(int32_t threadId, int32_t threads) const {
+  const char* data = file_.data();
+  const int64_t size = file_.size();
+  int64_t start = threadId * size / threads;
+  while (start > 0 && start < size && data[start - 1] != '\n') {
+    start++;
+  }
+  return start;
+}
+
+void Corpus::cache(const Dictionary& dict, int32_t threads) {
+  const char* data = file_.data();
+  // the shards start where the cursors of the training threads do
+  std::vector<int64_t> starts(threads + 1, file_.size());
+  for (int32_t i = 0; i < threads; i++) {
+    starts[i] = start(i, threads);
+  }
+  std::vector<std::vector<int32_t>> shards(threads);
+  std::vector<std::thread> workers;
+  for (int32_t i = 0; i < threads; i++) {
+    workers.push_back(std::thread([&, i]() {
+      dict.tokenize(data + starts[i], data + starts[i + 1], shards[i]);
+    }));
+  }
+  size_t size = 0;
+  for (int32_t i = 0; i < threads; i++) {
+    workers[i].join();
+    size += shards[i].size();
+  }
+  tokens_.clear();
+  tokens_.reserve(size);
+  tokenStarts_.clear();
+  for (int32_t i = 0; i < threads; i++) {
+    tokenStarts_.push_back(tokens_.size());
+    tokens_.insert(tokens_.end(), shards[i].cbegin(), shards[i].cend());
+    std::vector<int32_t>().swap(shards[i]);
+  }
+}
+
+CorpusCursor Corpus::cursor(int32_t threadId, int32_t threads) const {
+  CorpusCursor cursor;
+  if (!tokenStarts_.empty()) {
+    cursor.begin = cursor.end = cursor.p = nullptr;
+    cursor.ids = tokens_.data();
+    cursor.idsEnd = tokens_.data() + tokens_.size();
+    cursor.q = cursor.ids + tokenStarts_[threadId];
+    return cursor;
+  }
+  const char* data = file_.data();
+  const int64_t size = file_.size();
+  int64_t start = this->start(threadId, threads);
+  if (start == size) {
+    start = 0;
+  }
+  cursor.begin = data;
+  cursor.end = data + size;
+  cursor.p = data + start;
+  cursor.ids = cursor.idsEnd = cursor.q = nullptr;
+  return cursor;
+}
+
+}
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+namespace fasttext {
+
+class Dictionary;
+
+// where one training thread reads in a Corpus
+struct CorpusCursor {
+  const char* begin;
+  const char* end;
+  const char* p;
+  // the same in the tokens of a cached Corpus, null when it reads text
+  const int32_t* ids;
+  const int32_t* idsEnd;
+  const int32_t* q;
+};
+
+/**
+ * Training input mapped once for all the training threads, which tokenize
+ * it in place. Every thread starts on a line of its own, then reads on
+ * through the whole file, back from its start once at its end.
+ */
+class Corpus {
+  protected:
+    MappedFile file_;
+    std::vector<int32_t> tokens_;
+    std::vector<int64_t> tokenStarts_;
+
+    int64_t start(int32_t, int32_t) const;
+
+  public:
+    explicit Corpus(const std::string&);
+
+    // tokenizes the text once, with as many threads as will train on it,
+    // so that every epoch reads the ids of Dictionary::tokenize instead
+    void cache(const Dictionary&, int32_t);
+
+    // on the first line starting at or after threadId * size / threads
+    CorpusCursor cursor(int32_t threadId, int32_t threads) const;
+};
+
+}
@@ -10,6 +10,7 @@
 #include "dictionary.h"
 
 #include <assert.h>
+#include <string.h>
 
 #include <iostream>
 #include <fstream>
@@ -17,6 +18,9 @@
 #include <iterator>
 #include <cmath>
 #include <stdexcept>
+#include <thread>
+
+#include "utils.h"
 
 namespace fasttext {
 
@@ -25,7 +29,7 @@ const std::string Dictionary::BOW = "<";
 const std::string Dictionary::EOW = ">";
 
 Dictionary::Dictionary(std::shared_ptr<Args> args) : args_(args),
-  word2int_(MAX_VOCAB_SIZE, -1), size_(0), nwords_(0), nlabels_(0),
+  word2int_(MIN_TABLE_SIZE, -1), size_(0), nwords_(0), nlabels_(0),
   ntokens_(0), pruneidx_size_(-1) {}
 
 int32_t Dictionary::find(const std::string& w) const {
@@ -33,21 +37,64 @@ int32_t Dictionary::find(const std::string& w) const {
 }
 
 int32_t Dictionary::find(const std::string& w, uint32_t h) const {
-  int32_t id = h % MAX_VOCAB_SIZE;
+  const uint32_t tableSize = word2int_.size();
+  int32_t id = h % tableSize;
   while (word2int_[id] != -1 && words_[word2int_[id]].word != w) {
-    id = (id + 1) % MAX_VOCAB_SIZE;
+    id = (id + 1) % tableSize;
+  }
+  return id;
+}
+
+int32_t Dictionary::find(const char* w, size_t size, uint32_t h) const {
+  const uint32_t tableSize = word2int_.size();
+  int32_t id = h % tableSize;
+  while (word2int_[id] != -1) {
+    const std::string& word = words_[word2int_[id]].word;
+    if (word.size() == size && memcmp(word.data(), w, size) == 0) {
+      break;
+    }
+    id = (id + 1) % tableSize;
   }
   return id;
 }
 
+void Dictionary::resizeTable(int64_t n) {
+  // keep the load factor of the open addressing table under 0.75
+  int64_t tableSize = MIN_TABLE_SIZE;
+  while (tableSize < MAX_VOCAB_SIZE && 3 * tableSize < 4 * n) {
+    tableSize *= 2;
+  }
+  tableSize = std::min(tableSize, int64_t(MAX_VOCAB_SIZE));
+  word2int_.assign(tableSize, -1);
+  word2int_.shrink_to_fit();
+}
+
+void Dictionary::growTable() {
+  if (word2int_.size() >= MAX_VOCAB_SIZE ||
+      4 * int64_t(size_ + 1) <= 3 * int64_t(word2int_.size())) {
+    return;
+  }
+  resizeTable(2 * int64_t(size_ + 1));
+  for (int32_t i = 0; i < size_; i++) {
+    word2int_[find(words_[i].word)] = i;
+  }
+}
+
 void Dictionary::add(const std::string& w) {
-  int32_t h = find(w);
+  add(w.data(), w.size());
+}
+
+void Dictionary::add(const char* w, size_t size) {
+  uint32_t hw = hash(w, size);
+  int32_t h = find(w, size, hw);
   ntokens_++;
   if (word2int_[h] == -1) {
     entry e;
-    e.word = w;
+    e.word.assign(w, size);
     e.count = 1;
-    e.type = getType(w);
+    e.type = getType(e.word);
+    growTable();
+    h = find(w, size, hw);
     words_.push_back(e);
     word2int_[h] = size_++;
   } else {
@@ -118,6 +165,10 @@ int32_t Dictionary::getId(const std::string& w) const {
   return word2int_[h];
 }
 
+int32_t Dictionary::getId(const char* w, size_t size) const {
+  return word2int_[find(w, size, hash(w, size))];
+}
+
 entry_type Dictionary::getType(int32_t id) const {
   assert(id >= 0);
   assert(id < size_);
@@ -135,8 +186,14 @@ std::string Dictionary::getWord(int32_t id) const {
 }
 
 uint32_t Dictionary::hash(const std::string& str) const {
+  return hash(str.data(), str.size());
+}
+
+// bytes are hashed as char, which sign extends the ones over 0x7f where char
+// is signed: every id of a model depends on it
+uint32_t Dictionary::hash(const char* str, size_t size) const {
   uint32_t h = 2166136261;
-  for (size_t i = 0; i < str.size(); i++) {
+  for (size_t i = 0; i < size; i++) {
     h = h ^ uint32_t(str[i]);
     h = h * 16777619;
   }
@@ -165,22 +222,57 @@ void Dictionary::computeSubwords(const std::string& word,
 
 void Dictionary::computeSubwords(const std::string& word,
                                std::vector<int32_t>& ngrams) const {
+  // every n-gram starting at i extends the previous one, so is its hash
   for (size_t i = 0; i < word.size(); i++) {
-    std::string ngram;
     if ((word[i] & 0xC0) == 0x80) continue;
+    uint32_t h = 2166136261;
     for (size_t j = i, n = 1; j < word.size() && n <= args_->maxn; n++) {
-      ngram.push_back(word[j++]);
+      h = (h ^ uint32_t(word[j++])) * 16777619;
       while (j < word.size() && (word[j] & 0xC0) == 0x80) {
-        ngram.push_back(word[j++]);
+        h = (h ^ uint32_t(word[j++])) * 16777619;
       }
       if (n >= args_->minn && !(n == 1 && (i == 0 || j == word.size()))) {
-        int32_t h = hash(ngram) % args_->bucket;
-        pushHash(ngrams, h);
+        pushHash(ngrams, h % args_->bucket);
       }
     }
   }
 }
 
+void Dictionary::computeSubwords(const char* token, size_t size,
+                               std::vector<int32_t>& ngrams) const {
+  // same as computeSubwords(BOW + token + EOW), without building the string
+  const size_t bow = BOW.size();
+  const size_t length = bow + size + EOW.size();
+  auto at = [&](size_t k) {
+    return k < bow ? BOW[k] : k < bow + size ? token[k - bow] : EOW[k - bow - size];
+  };
+  for (size_t i = 0; i < length; i++) {
+    if ((at(i) & 0xC0) == 0x80) continue;
+    uint32_t h = 2166136261;
+    size_t j = i;
+    for (int32_t n = 1; j < length && n <= args_->maxn; n++) {
+      h = (h ^ uint32_t(at(j++))) * 16777619;
+      while (j < length && (at(j) & 0xC0) == 0x80) {
+        h = (h ^ uint32_t(at(j++))) * 16777619;
+      }
+      if (n >= args_->minn && !(n == 1 && (i == 0 || j == length))) {
+        pushHash(ngrams, h % args_->bucket);
+      }
+    }
+  }
+}
+
+void Dictionary::getSubwords(const char* word, size_t size,
+                             std::vector<int32_t>& ngrams) const {
+  int32_t i = getId(word, size);
+  if (i >= 0) {
+    const std::vector<int32_t>& subwords = getSubwords(i);
+    ngrams.insert(ngrams.end(), subwords.cbegin(), subwords.cend());
+  } else if (size != EOS.size() || memcmp(word, EOS.data(), size) != 0) {
+    computeSubwords(word, size, ngrams);
+  }
+}
+
 void Dictionary::initNgrams() {
   for (size_t i = 0; i < size_; i++) {
     std::string word = BOW + words_[i].word + EOW;
@@ -232,6 +324,92 @@ void Dictionary::readFromFile(std::istream& in) {
       threshold(minThreshold, minThreshold);
     }
   }
+  finishReading();
+}
+
+// counts the tokens of [begin, end) the way readFromFile(std::istream&) does
+void Dictionary::addAll(const char* begin, const char* end) {
+  const char* p = begin;
+  const char* token;
+  size_t size;
+  int64_t minThreshold = 1;
+  while (nextToken(p, end, token, size)) {
+    add(token, size);
+    if (size_ > 0.75 * MAX_VOCAB_SIZE) {
+      minThreshold++;
+      threshold(minThreshold, minThreshold);
+    }
+  }
+}
+
+void Dictionary::readFromFile(const std::string& filename) {
+  if (args_->dictThreads <= 1) {
+    std::ifstream ifs(filename);
+    if (!ifs.is_open()) {
+      throw std::invalid_argument(filename + " cannot be opened for training!");
+    }
+    readFromFile(ifs);
+    return;
+  }
+  MappedFile file(filename);
+  const char* data = file.data();
+  const int64_t size = file.size();
+  const int32_t nshards = args_->dictThreads;
+
+  // every range but the first starts right after a newline, so no token
+  // and no line is split between two of them
+  std::vector<int64_t> bounds(nshards + 1, size);
+  bounds[0] = 0;
+  for (int32_t i = 1; i < nshards; i++) {
+    int64_t b = std::max(i * size / nshards, bounds[i - 1]);
+    while (b > 0 && b < size && data[b - 1] != '\n') {
+      b++;
+    }
+    bounds[i] = b;
+  }
+
+  std::vector<std::unique_ptr<Dictionary>> shards;
+  for (int32_t i = 0; i < nshards; i++) {
+    shards.emplace_back(new Dictionary(args_));
+  }
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < nshards; i++) {
+    threads.push_back(std::thread([&, i]() {
+      shards[i]->addAll(data + bounds[i], data + bounds[i + 1]);
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // merged in file order, every word keeps the place of its first
+  // occurrence: threshold() then sorts the same sequence as a serial read.
+  // It only differs once the vocabulary grows past 0.75 * MAX_VOCAB_SIZE,
+  // where both prune early at points of their own
+  int64_t minThreshold = 1;
+  for (auto& shard : shards) {
+    for (entry& e : shard->words_) {
+      int32_t h = find(e.word);
+      if (word2int_[h] == -1) {
+        growTable();
+        h = find(e.word);
+        word2int_[h] = size_++;
+        words_.push_back(std::move(e));
+      } else {
+        words_[word2int_[h]].count += e.count;
+      }
+    }
+    ntokens_ += shard->ntokens_;
+    shard.reset();
+    if (size_ > 0.75 * MAX_VOCAB_SIZE) {
+      minThreshold++;
+      threshold(minThreshold, minThreshold);
+    }
+  }
+  finishReading();
+}
+
+void Dictionary::finishReading() {
   threshold(args_->minCount, args_->minCountLabel);
   initTableDiscard();
   initNgrams();
@@ -259,7 +437,7 @@ void Dictionary::threshold(int64_t t, int64_t tl) {
   size_ = 0;
   nwords_ = 0;
   nlabels_ = 0;
-  std::fill(word2int_.begin(), word2int_.end(), -1);
+  resizeTable(words_.size());
   for (auto it = words_.begin(); it != words_.end(); ++it) {
     int32_t h = find(it->word);
     word2int_[h] = size_++;
@@ -347,6 +525,19 @@ int32_t Dictionary::getLine(std::istream& in,
                             std::vector<int32_t>& words,
                             std::vector<int32_t>& labels,
                             std::minstd_rand& rng) const {
+  return readLine(in, words, labels, true);
+}
+
+int32_t Dictionary::getCompactLine(std::istream& in,
+                                   std::vector<int32_t>& words,
+                                   std::vector<int32_t>& labels) const {
+  return readLine(in, words, labels, false);
+}
+
+int32_t Dictionary::readLine(std::istream& in,
+                             std::vector<int32_t>& words,
+                             std::vector<int32_t>& labels,
+                             bool expandWords) const {
   std::vector<int32_t> word_hashes;
   std::string token;
   int32_t ntokens = 0;
@@ -361,7 +552,11 @@ int32_t Dictionary::getLine(std::istream& in,
 
     ntokens++;
     if (type == entry_type::word) {
-      addSubwords(words, token, wid);
+      if (expandWords || wid < 0) {
+        addSubwords(words, token, wid);
+      } else {
+        words.push_back(wid);
+      }
       word_hashes.push_back(h);
     } else if (type == entry_type::label && wid >= 0) {
       labels.push_back(wid - nwords_);
@@ -372,6 +567,184 @@ int32_t Dictionary::getLine(std::istream& in,
   return ntokens;
 }
 
+static bool isSeparator(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' ||
+    c == '\f' || c == '\0';
+}
+
+// the tokens readWord would return for the same bytes, as pointers into them
+bool Dictionary::nextToken(const char*& p, const char* end,
+                           const char*& token, size_t& size) const {
+  for (; p < end && isSeparator(*p); p++) {
+    if (*p == '\n') {
+      p++;
+      token = EOS.data();
+      size = EOS.size();
+      return true;
+    }
+  }
+  if (p == end) {
+    return false;
+  }
+  token = p;
+  while (p < end && !isSeparator(*p)) {
+    p++;
+  }
+  size = p - token;
+  return true;
+}
+
+int32_t Dictionary::getLine(const char* line, size_t size,
+                            std::vector<int32_t>& words,
+                            std::vector<int32_t>& labels) const {
+  const char* p = line;
+  return readLine(p, line + size, words, labels, true);
+}
+
+int32_t Dictionary::getCompactLine(const char* line, size_t size,
+                                   std::vector<int32_t>& words,
+                                   std::vector<int32_t>& labels) const {
+  const char* p = line;
+  return readLine(p, line + size, words, labels, false);
+}
+
+void Dictionary::reset(CorpusCursor& cursor) const {
+  if (cursor.ids) {
+    if (cursor.q == cursor.idsEnd) {
+      cursor.q = cursor.ids;
+    }
+  } else if (cursor.p == cursor.end) {
+    cursor.p = cursor.begin;
+  }
+}
+
+int32_t Dictionary::getLine(CorpusCursor& cursor,
+                            std::vector<int32_t>& words,
+                            std::minstd_rand& rng) const {
+  std::uniform_real_distribution<> uniform(0, 1);
+  const char* token;
+  size_t size;
+  int32_t ntokens = 0;
+
+  reset(cursor);
+  words.clear();
+  if (cursor.ids) {
+    const int32_t eos = getId(EOS);
+    while (cursor.q < cursor.idsEnd) {
+      int32_t wid = *cursor.q++;
+      ntokens++;
+      if (getType(wid) == entry_type::word && !discard(wid, uniform(rng))) {
+        words.push_back(wid);
+      }
+      if (ntokens > MAX_LINE_SIZE || wid == eos) break;
+    }
+    return ntokens;
+  }
+  while (nextToken(cursor.p, cursor.end, token, size)) {
+    int32_t wid = word2int_[find(token, size, hash(token, size))];
+    if (wid < 0) continue;
+
+    ntokens++;
+    if (getType(wid) == entry_type::word && !discard(wid, uniform(rng))) {
+      words.push_back(wid);
+    }
+    bool eos = size == EOS.size() && memcmp(token, EOS.data(), size) == 0;
+    if (ntokens > MAX_LINE_SIZE || eos) break;
+  }
+  return ntokens;
+}
+
+int32_t Dictionary::getLine(CorpusCursor& cursor,
+                            std::vector<int32_t>& words,
+                            std::vector<int32_t>& labels,
+                            std::minstd_rand& rng) const {
+  reset(cursor);
+  if (cursor.ids) {
+    const int32_t* q = cursor.q;
+    const int32_t* labelsBegin = q + 3 + q[1];
+    words.assign(q + 3, labelsBegin);
+    labels.assign(labelsBegin, labelsBegin + q[2]);
+    cursor.q = labelsBegin + q[2];
+    return q[0];
+  }
+  return readLine(cursor.p, cursor.end, words, labels, true);
+}
+
+void Dictionary::tokenize(const char* begin, const char* end,
+                          std::vector<int32_t>& tokens) const {
+  const char* p = begin;
+  if (args_->model == model_name::sup) {
+    std::vector<int32_t> words, labels;
+    while (p < end) {
+      tokens.push_back(readLine(p, end, words, labels, true));
+      tokens.push_back(words.size());
+      tokens.push_back(labels.size());
+      tokens.insert(tokens.end(), words.cbegin(), words.cend());
+      tokens.insert(tokens.end(), labels.cbegin(), labels.cend());
+    }
+    return;
+  }
+  const char* token;
+  size_t size;
+  while (nextToken(p, end, token, size)) {
+    int32_t wid = word2int_[find(token, size, hash(token, size))];
+    if (wid >= 0) {
+      tokens.push_back(wid);
+    }
+  }
+}
+
+// reads from p up to the end of the line, or to end, and leaves p after it
+int32_t Dictionary::readLine(const char*& p, const char* end,
+                             std::vector<int32_t>& words,
+                             std::vector<int32_t>& labels,
+                             bool expandWords) const {
+  // kept by the thread, so that reading a line does not allocate once grown
+  static thread_local std::vector<int32_t> word_hashes;
+  word_hashes.clear();
+  const std::string& label = args_->label;
+  const char* token;
+  size_t length;
+  int32_t ntokens = 0;
+
+  words.clear();
+  labels.clear();
+  while (nextToken(p, end, token, length)) {
+    uint32_t h = hash(token, length);
+    int32_t wid = word2int_[find(token, length, h)];
+    bool eos = length == EOS.size() && memcmp(token, EOS.data(), length) == 0;
+    entry_type type;
+    if (wid >= 0) {
+      type = getType(wid);
+    } else if (length >= label.size() &&
+        memcmp(token, label.data(), label.size()) == 0) {
+      type = entry_type::label;
+    } else {
+      type = entry_type::word;
+    }
+
+    ntokens++;
+    if (type == entry_type::word) {
+      if (wid < 0) {
+        if (!eos) {
+          computeSubwords(token, length, words);
+        }
+      } else if (expandWords && args_->maxn > 0) {
+        const std::vector<int32_t>& ngrams = getSubwords(wid);
+        words.insert(words.end(), ngrams.cbegin(), ngrams.cend());
+      } else {
+        words.push_back(wid);
+      }
+      word_hashes.push_back(h);
+    } else if (type == entry_type::label && wid >= 0) {
+      labels.push_back(wid - nwords_);
+    }
+    if (eos) break;
+  }
+  addWordNgrams(words, word_hashes, args_->wordNgrams);
+  return ntokens;
+}
+
 void Dictionary::pushHash(std::vector<int32_t>& hashes, int32_t id) const {
   if (pruneidx_size_ == 0 || id < 0) return;
   if (pruneidx_size_ > 0) {
@@ -384,7 +757,7 @@ void Dictionary::pushHash(std::vector<int32_t>& hashes, int32_t id) const {
   hashes.push_back(nwords_ + id);
 }
 
-std::string Dictionary::getLabel(int32_t lid) const {
+const std::string& Dictionary::getLabel(int32_t lid) const {
   if (lid < 0 || lid >= nlabels_) {
     throw std::invalid_argument(
         "Label id is out of range [0, " + std::to_string(nlabels_) + "]");
@@ -413,12 +786,13 @@ void Dictionary::save(std::ostream& out) const {
 
 void Dictionary::load(std::istream& in) {
   words_.clear();
-  std::fill(word2int_.begin(), word2int_.end(), -1);
   in.read((char*) &size_, sizeof(int32_t));
   in.read((char*) &nwords_, sizeof(int32_t));
   in.read((char*) &nlabels_, sizeof(int32_t));
   in.read((char*) &ntokens_, sizeof(int64_t));
   in.read((char*) &pruneidx_size_, sizeof(int64_t));
+  resizeTable(size_);
+  words_.reserve(size_);
   for (int32_t i = 0; i < size_; i++) {
     char c;
     entry e;
@@ -442,6 +816,89 @@ void Dictionary::load(std::istream& in) {
   initNgrams();
 }
 
+void Dictionary::saveMapped(std::ostream& out) const {
+  // flat arrays instead of a stream of entries: loadMapped copies them out
+  // in bulk and reuses the hash table and subwords computed here
+  int64_t tableSize = word2int_.size();
+  out.write((char*) &size_, sizeof(int32_t));
+  out.write((char*) &nwords_, sizeof(int32_t));
+  out.write((char*) &nlabels_, sizeof(int32_t));
+  out.write((char*) &ntokens_, sizeof(int64_t));
+  out.write((char*) &pruneidx_size_, sizeof(int64_t));
+  out.write((char*) &tableSize, sizeof(int64_t));
+
+  std::vector<int64_t> wordOffsets(1, 0), subwordOffsets(1, 0);
+  for (int32_t i = 0; i < size_; i++) {
+    wordOffsets.push_back(wordOffsets.back() + words_[i].word.size());
+    subwordOffsets.push_back(subwordOffsets.back() + words_[i].subwords.size());
+  }
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  for (int32_t i = 0; i < size_; i++) {
+    out.write((char*) &(words_[i].count), sizeof(int64_t));
+  }
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  for (int32_t i = 0; i < size_; i++) {
+    out.write((char*) &(words_[i].type), sizeof(entry_type));
+  }
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  out.write((char*) wordOffsets.data(), wordOffsets.size() * sizeof(int64_t));
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  for (int32_t i = 0; i < size_; i++) {
+    out.write(words_[i].word.data(), words_[i].word.size() * sizeof(char));
+  }
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  out.write((char*) subwordOffsets.data(),
+            subwordOffsets.size() * sizeof(int64_t));
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  for (int32_t i = 0; i < size_; i++) {
+    out.write((char*) words_[i].subwords.data(),
+              words_[i].subwords.size() * sizeof(int32_t));
+  }
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  out.write((char*) word2int_.data(), tableSize * sizeof(int32_t));
+  utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+  for (const auto pair : pruneidx_) {
+    out.write((char*) &(pair.first), sizeof(int32_t));
+    out.write((char*) &(pair.second), sizeof(int32_t));
+  }
+}
+
+void Dictionary::loadMapped(MappedStream& in) {
+  int64_t tableSize;
+  in.read((char*) &size_, sizeof(int32_t));
+  in.read((char*) &nwords_, sizeof(int32_t));
+  in.read((char*) &nlabels_, sizeof(int32_t));
+  in.read((char*) &ntokens_, sizeof(int64_t));
+  in.read((char*) &pruneidx_size_, sizeof(int64_t));
+  in.read((char*) &tableSize, sizeof(int64_t));
+
+  const int64_t* counts = in.view<int64_t>(size_);
+  const entry_type* types = in.view<entry_type>(size_);
+  const int64_t* wordOffsets = in.view<int64_t>(size_ + 1);
+  const char* strings = in.view<char>(wordOffsets[size_]);
+  const int64_t* subwordOffsets = in.view<int64_t>(size_ + 1);
+  const int32_t* subwords = in.view<int32_t>(subwordOffsets[size_]);
+  const int32_t* table = in.view<int32_t>(tableSize);
+  const int32_t* pruned = in.view<int32_t>(2 * std::max<int64_t>(pruneidx_size_, 0));
+
+  words_.clear();
+  words_.resize(size_);
+  for (int32_t i = 0; i < size_; i++) {
+    entry& e = words_[i];
+    e.word.assign(strings + wordOffsets[i], wordOffsets[i + 1] - wordOffsets[i]);
+    e.count = counts[i];
+    e.type = types[i];
+    e.subwords.assign(subwords + subwordOffsets[i],
+                      subwords + subwordOffsets[i + 1]);
+  }
+  word2int_.assign(table, table + tableSize);
+  pruneidx_.clear();
+  for (int64_t i = 0; i < pruneidx_size_; i++) {
+    pruneidx_[pruned[2 * i]] = pruned[2 * i + 1];
+  }
+  initTableDiscard();
+}
+
 void Dictionary::prune(std::vector<int32_t>& idx) {
   std::vector<int32_t> words, ngrams;
   for (auto it = idx.cbegin(); it != idx.cend(); ++it) {
@@ -461,7 +918,7 @@ void Dictionary::prune(std::vector<int32_t>& idx) {
   }
   pruneidx_size_ = pruneidx_.size();
 
-  std::fill(word2int_.begin(), word2int_.end(), -1);
+  resizeTable(words.size() + nlabels_);
 
   int32_t j = 0;
   for (int32_t i = 0; i < words_.size(); i++) {
@@ -18,6 +18,8 @@
 #include <unordered_map>
 
 #include "args.h"
+#include "corpus.h"
+#include "mappedfile.h"
 #include "real.h"
 
 namespace fasttext {
@@ -35,15 +37,29 @@ struct entry {
 class Dictionary {
   protected:
     static const int32_t MAX_VOCAB_SIZE = 30000000;
+    static const int32_t MIN_TABLE_SIZE = 1024;
     static const int32_t MAX_LINE_SIZE = 1024;
 
     int32_t find(const std::string&) const;
     int32_t find(const std::string&, uint32_t h) const;
+    int32_t find(const char*, size_t, uint32_t h) const;
+    void resizeTable(int64_t);
+    void growTable();
     void initTableDiscard();
     void initNgrams();
     void reset(std::istream&) const;
+    void reset(CorpusCursor&) const;
     void pushHash(std::vector<int32_t>&, int32_t) const;
     void addSubwords(std::vector<int32_t>&, const std::string&, int32_t) const;
+    int32_t readLine(std::istream&, std::vector<int32_t>&,
+                     std::vector<int32_t>&, bool) const;
+    int32_t readLine(const char*&, const char*, std::vector<int32_t>&,
+                     std::vector<int32_t>&, bool) const;
+    bool nextToken(const char*&, const char*, const char*&, size_t&) const;
+    void computeSubwords(const char*, size_t, std::vector<int32_t>&) const;
+    void add(const char*, size_t);
+    void addAll(const char*, const char*);
+    void finishReading();
 
     std::shared_ptr<Args> args_;
     std::vector<int32_t> word2int_;
@@ -74,6 +90,7 @@ class Dictionary {
     int64_t ntokens() const;
     int32_t getId(const std::string&) const;
     int32_t getId(const std::string&, uint32_t h) const;
+    int32_t getId(const char*, size_t) const;
     entry_type getType(int32_t) const;
     entry_type getType(const std::string&) const;
     bool discard(int32_t, real) const;
@@ -84,23 +101,54 @@ class Dictionary {
         const std::string&,
         std::vector<int32_t>&,
         std::vector<std::string>&) const;
+    // appends the same ids as getSubwords(std::string), without copying the
+    // word
+    void getSubwords(const char*, size_t, std::vector<int32_t>&) const;
     void computeSubwords(const std::string&, std::vector<int32_t>&) const;
     void computeSubwords(
         const std::string&,
         std::vector<int32_t>&,
         std::vector<std::string>&) const;
     uint32_t hash(const std::string& str) const;
+    uint32_t hash(const char* str, size_t size) const;
     void add(const std::string&);
     bool readWord(std::istream&, std::string&) const;
     void readFromFile(std::istream&);
-    std::string getLabel(int32_t) const;
+    // same vocabulary as readFromFile(std::istream&), read by
+    // args->dictThreads threads over line aligned ranges of the file
+    void readFromFile(const std::string&);
+    const std::string& getLabel(int32_t) const;
     void save(std::ostream&) const;
     void load(std::istream&);
+    void saveMapped(std::ostream&) const;
+    void loadMapped(MappedStream&);
     std::vector<int64_t> getCounts(entry_type) const;
     int32_t getLine(std::istream&, std::vector<int32_t>&,
                     std::vector<int32_t>&, std::minstd_rand&) const;
     int32_t getLine(std::istream&, std::vector<int32_t>&,
                     std::minstd_rand&) const;
+    // like getLine, but a word of the vocabulary stays a single id instead
+    // of being expanded into its subwords
+    int32_t getCompactLine(std::istream&, std::vector<int32_t>&,
+                           std::vector<int32_t>&) const;
+    // same as getLine and getCompactLine over a line already in memory: the
+    // tokens and their n-grams are hashed in place, nothing is allocated
+    // per token
+    int32_t getLine(const char*, size_t, std::vector<int32_t>&,
+                    std::vector<int32_t>&) const;
+    int32_t getCompactLine(const char*, size_t, std::vector<int32_t>&,
+                           std::vector<int32_t>&) const;
+    // same as the training getLine over a mapped Corpus: the cursor moves
+    // past the line read, and back to the start once it reaches the end
+    int32_t getLine(CorpusCursor&, std::vector<int32_t>&,
+                    std::vector<int32_t>&, std::minstd_rand&) const;
+    int32_t getLine(CorpusCursor&, std::vector<int32_t>&,
+                    std::minstd_rand&) const;
+    // what those read from the text, as the ids a cached Corpus keeps: the
+    // known tokens for word vectors, so that discard still draws every
+    // epoch, and for a classifier whole lines with their subwords and
+    // n-grams, as counts of tokens, words and labels then their ids
+    void tokenize(const char*, const char*, std::vector<int32_t>&) const;
     void threshold(int64_t, int64_t);
     void prune(std::vector<int32_t>&);
     bool isPruned() { return pruneidx_size_ >= 0; }
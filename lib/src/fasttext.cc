@@ -562,8 +562,7 @@ void FastText::analogies(int32_t k) {
 }
 
 void FastText::trainThread(int32_t threadId) {
-  std::ifstream ifs(args_->input);
-  utils::seek(ifs, threadId * utils::size(ifs) / args_->thread);
+  CorpusCursor cursor = corpus_->cursor(threadId, args_->thread);
 
   Model model(input_, output_, args_, threadId);
   if (args_->model == model_name::sup) {
@@ -579,13 +578,13 @@ void FastText::trainThread(int32_t threadId) {
     real progress = real(tokenCount_) / (args_->epoch * ntokens);
     real lr = args_->lr * (1.0 - progress);
     if (args_->model == model_name::sup) {
-      localTokenCount += dict_->getLine(ifs, line, labels, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, labels, model.rng);
       supervised(model, lr, line, labels);
     } else if (args_->model == model_name::cbow) {
-      localTokenCount += dict_->getLine(ifs, line, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, model.rng);
       cbow(model, lr, line);
     } else if (args_->model == model_name::sg) {
-      localTokenCount += dict_->getLine(ifs, line, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, model.rng);
       skipgram(model, lr, line);
     }
     if (localTokenCount > args_->lrUpdateRate) {
@@ -594,7 +593,6 @@ void FastText::trainThread(int32_t threadId) {
       if (threadId == 0) loss_ = model.getLoss();
     }
   }
-  ifs.close();
 }
 
 void FastText::loadVectors(std::string filename) {
@@ -643,13 +641,7 @@ void FastText::train(const Args args) {
     // manage expectations
     throw std::invalid_argument("Cannot use stdin for training!");
   }
-  std::ifstream ifs(args_->input);
-  if (!ifs.is_open()) {
-    throw std::invalid_argument(
-        args_->input + " cannot be opened for training!");
-  }
-  dict_->readFromFile(ifs);
-  ifs.close();
+  dict_->readFromFile(args_->input);
 
   if (args_->pretrainedVectors.size() != 0) {
     loadVectors(args_->pretrainedVectors);
@@ -677,6 +669,10 @@ void FastText::startThreads() {
   start_ = clock();
   tokenCount_ = 0;
   loss_ = -1;
+  corpus_ = std::make_shared<Corpus>(args_->input);
+  if (args_->cacheCorpus) {
+    corpus_->cache(*dict_, args_->thread);
+  }
   std::vector<std::thread> threads;
   for (int32_t i = 0; i < args_->thread; i++) {
     threads.push_back(std::thread([=]() { trainThread(i); }));
@@ -694,6 +690,7 @@ void FastText::startThreads() {
   for (int32_t i = 0; i < args_->thread; i++) {
     threads[i].join();
   }
+  corpus_.reset();
   if (args_->verbose > 0) {
       std::cerr << "\r";
       printInfo(1.0, loss_, std::cerr);
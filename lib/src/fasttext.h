@@ -18,6 +18,7 @@
 #include <iostream>
 
 #include "args.h"
+#include "corpus.h"
 #include "dictionary.h"
 #include "matrix.h"
 #include "model.h"
@@ -40,6 +41,8 @@ class FastText {
   std::shared_ptr<QMatrix> qoutput_;
 
   std::shared_ptr<Model> model_;
+  // the training input, only while the training threads run
+  std::shared_ptr<Corpus> corpus_;
 
   std::atomic<int64_t> tokenCount_;
   std::atomic<real> loss_;
@@ -0,0 +1,241 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "kernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FASTTEXT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace fasttext {
+
+namespace {
+
+void addScalar(real* y, const real* x, int64_t n) {
+  for (int64_t i = 0; i < n; i++) {
+    y[i] += x[i];
+  }
+}
+
+void axpyScalar(real* y, const real* x, real a, int64_t n) {
+  for (int64_t i = 0; i < n; i++) {
+    y[i] += a * x[i];
+  }
+}
+
+real dotScalar(const real* x, const real* y, int64_t n) {
+  real d = 0.0;
+  for (int64_t i = 0; i < n; i++) {
+    d += x[i] * y[i];
+  }
+  return d;
+}
+
+const KernelSet scalarKernels = {"scalar", addScalar, axpyScalar, dotScalar};
+
+#ifdef FASTTEXT_X86_KERNELS
+
+// add and axpy round every element exactly like the scalar loop (no fma),
+// so training and hidden layers do not depend on the selected kernel
+
+__attribute__((target("sse4.1")))
+void addSse(real* y, const real* x, int64_t n) {
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+  }
+  for (; i < n; i++) {
+    y[i] += x[i];
+  }
+}
+
+__attribute__((target("sse4.1")))
+void axpySse(real* y, const real* x, real a, int64_t n) {
+  const __m128 va = _mm_set1_ps(a);
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 p = _mm_mul_ps(va, _mm_loadu_ps(x + i));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), p));
+  }
+  for (; i < n; i++) {
+    y[i] += a * x[i];
+  }
+}
+
+__attribute__((target("sse4.1")))
+real dotSse(const real* x, const real* y, int64_t n) {
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+    s1 = _mm_add_ps(s1,
+        _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+  }
+  s0 = _mm_add_ps(s0, s1);
+  s0 = _mm_hadd_ps(s0, s0);
+  s0 = _mm_hadd_ps(s0, s0);
+  real d = _mm_cvtss_f32(s0);
+  for (; i < n; i++) {
+    d += x[i] * y[i];
+  }
+  return d;
+}
+
+__attribute__((target("avx2,fma")))
+void addAvx2(real* y, const real* x, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(y + i,
+        _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+  }
+  for (; i < n; i++) {
+    y[i] += x[i];
+  }
+}
+
+__attribute__((target("avx2,fma")))
+void axpyAvx2(real* y, const real* x, real a, int64_t n) {
+  const __m256 va = _mm256_set1_ps(a);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 p = _mm256_mul_ps(va, _mm256_loadu_ps(x + i));
+    _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), p));
+  }
+  for (; i < n; i++) {
+    y[i] += a * x[i];
+  }
+}
+
+// sum of the 8 lanes, shared by the AVX2 and AVX-512 dots
+__attribute__((target("avx")))
+inline real sumAvx(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_hadd_ps(s, s);
+  s = _mm_hadd_ps(s, s);
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+real dotAvx2(const real* x, const real* y, int64_t n) {
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+    s1 = _mm256_fmadd_ps(
+        _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), s1);
+  }
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+  }
+  real d = sumAvx(_mm256_add_ps(s0, s1));
+  for (; i < n; i++) {
+    d += x[i] * y[i];
+  }
+  return d;
+}
+
+__attribute__((target("avx512f")))
+void addAvx512(real* y, const real* x, int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_ps(y + i,
+        _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+  }
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_ps(y + i, m, _mm512_add_ps(
+        _mm512_maskz_loadu_ps(m, y + i), _mm512_maskz_loadu_ps(m, x + i)));
+  }
+}
+
+__attribute__((target("avx512f")))
+void axpyAvx512(real* y, const real* x, real a, int64_t n) {
+  const __m512 va = _mm512_set1_ps(a);
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 p = _mm512_mul_ps(va, _mm512_loadu_ps(x + i));
+    _mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), p));
+  }
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    __m512 p = _mm512_mul_ps(va, _mm512_maskz_loadu_ps(m, x + i));
+    _mm512_mask_storeu_ps(y + i, m,
+        _mm512_add_ps(_mm512_maskz_loadu_ps(m, y + i), p));
+  }
+}
+
+__attribute__((target("avx512f")))
+real dotAvx512(const real* x, const real* y, int64_t n) {
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+  int64_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+    s1 = _mm512_fmadd_ps(
+        _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), s1);
+  }
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+  }
+  if (i < n) {
+    __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+    s1 = _mm512_fmadd_ps(
+        _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i), s1);
+  }
+  // by hand: _mm512_reduce_add_ps, and the unmasked extracts it is made of,
+  // warn about an uninitialized __Y under gcc 12
+  __m512d s = _mm512_castps_pd(_mm512_add_ps(s0, s1));
+  __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xf, s, 0));
+  __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xf, s, 1));
+  return sumAvx(_mm256_add_ps(lo, hi));
+}
+
+const KernelSet sseKernels = {"sse4.1", addSse, axpySse, dotSse};
+const KernelSet avx2Kernels = {"avx2", addAvx2, axpyAvx2, dotAvx2};
+const KernelSet avx512Kernels = {"avx512f", addAvx512, axpyAvx512, dotAvx512};
+
+#endif
+
+const KernelSet* select() {
+  std::vector<const KernelSet*> candidates = kernels::supported();
+  return candidates.back();
+}
+
+}
+
+namespace kernels {
+
+std::vector<const KernelSet*> supported() {
+  std::vector<const KernelSet*> result;
+  result.push_back(&scalarKernels);
+#ifdef FASTTEXT_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1")) {
+    result.push_back(&sseKernels);
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    result.push_back(&avx2Kernels);
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    result.push_back(&avx512Kernels);
+  }
+#endif
+  return result;
+}
+
+const KernelSet* active() {
+  // set on first use, so that no static initializer can see it unset
+  static const KernelSet* const selected = select();
+  return selected;
+}
+
+}
+
+}
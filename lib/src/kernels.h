@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "real.h"
+
+namespace fasttext {
+
+/**
+ * Inner loops shared by Vector and Matrix. Several implementations are
+ * compiled in and the widest one the CPU supports is picked when the library
+ * is loaded, so the binary does not depend on -march.
+ */
+struct KernelSet {
+  const char* name;
+  // y += x
+  void (*add)(real* y, const real* x, int64_t n);
+  // y += a * x
+  void (*axpy)(real* y, const real* x, real a, int64_t n);
+  // sum of x * y
+  real (*dot)(const real* x, const real* y, int64_t n);
+};
+
+namespace kernels {
+
+  // the widest implementation this CPU supports
+  const KernelSet* active();
+
+  // every implementation this CPU can run, scalar first
+  std::vector<const KernelSet*> supported();
+
+  inline void add(real* y, const real* x, int64_t n) {
+    active()->add(y, x, n);
+  }
+
+  inline void axpy(real* y, const real* x, real a, int64_t n) {
+    active()->axpy(y, x, a, n);
+  }
+
+  inline real dot(const real* x, const real* y, int64_t n) {
+    return active()->dot(x, y, n);
+  }
+}
+
+}
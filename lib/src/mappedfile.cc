@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "mappedfile.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fasttext {
+
+MappedFile::MappedFile(const std::string& filename)
+    : data_(nullptr), size_(0), mapped_(false) {
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::invalid_argument(filename + " cannot be opened for loading!");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::invalid_argument(filename + " cannot be opened for loading!");
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      throw std::invalid_argument(filename + " cannot be mapped!");
+    }
+    data_ = static_cast<char*>(addr);
+    mapped_ = true;
+  }
+  close(fd);
+#else
+  // no mmap here, fall back to one big read
+  std::ifstream ifs(filename, std::ifstream::binary);
+  if (!ifs.is_open()) {
+    throw std::invalid_argument(filename + " cannot be opened for loading!");
+  }
+  ifs.seekg(0, std::ios::end);
+  size_ = ifs.tellg();
+  ifs.seekg(0, std::ios::beg);
+  data_ = new char[size_];
+  ifs.read(data_, size_);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapped_) {
+    munmap(data_, size_);
+  }
+#else
+  delete[] data_;
+#endif
+}
+
+MappedBuffer::MappedBuffer(const char* data, int64_t size) {
+  char* begin = const_cast<char*>(data);
+  setg(begin, begin, begin + size);
+}
+
+MappedBuffer::pos_type MappedBuffer::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) {
+  char* target;
+  if (dir == std::ios_base::beg) {
+    target = eback() + off;
+  } else if (dir == std::ios_base::cur) {
+    target = gptr() + off;
+  } else {
+    target = egptr() + off;
+  }
+  if (target < eback() || target > egptr()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), target, egptr());
+  return pos_type(target - eback());
+}
+
+MappedBuffer::pos_type MappedBuffer::seekpos(
+    pos_type pos, std::ios_base::openmode mode) {
+  return seekoff(off_type(pos), std::ios_base::beg, mode);
+}
+
+MappedStream::MappedStream(std::shared_ptr<const MappedFile> file)
+    : std::istream(nullptr), file_(file),
+      buffer_(file->data(), file->size()) {
+  rdbuf(&buffer_);
+}
+
+void MappedStream::align(int64_t alignment) {
+  int64_t pos = tellg();
+  int64_t rem = pos % alignment;
+  if (rem != 0) {
+    seekg(alignment - rem, std::ios_base::cur);
+  }
+}
+
+}
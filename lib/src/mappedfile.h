@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+namespace fasttext {
+
+// alignment of matrix payloads in mapped model files
+constexpr int64_t MAPPED_PAGE_SIZE = 4096;
+// alignment of every other array in mapped model files
+constexpr int64_t MAPPED_ARRAY_ALIGNMENT = 8;
+
+class MappedFile {
+  protected:
+    char* data_;
+    int64_t size_;
+    bool mapped_;
+
+  public:
+    explicit MappedFile(const std::string&);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const { return data_; }
+    int64_t size() const { return size_; }
+};
+
+class MappedBuffer : public std::streambuf {
+  public:
+    MappedBuffer(const char*, int64_t);
+
+  protected:
+    pos_type seekoff(off_type, std::ios_base::seekdir,
+                     std::ios_base::openmode) override;
+    pos_type seekpos(pos_type, std::ios_base::openmode) override;
+};
+
+/**
+ * Reads a mapped file like any other stream, but large arrays can be viewed
+ * in place instead of being copied out.
+ */
+class MappedStream : public std::istream {
+  protected:
+    std::shared_ptr<const MappedFile> file_;
+    MappedBuffer buffer_;
+
+  public:
+    explicit MappedStream(std::shared_ptr<const MappedFile>);
+
+    std::shared_ptr<const MappedFile> file() const { return file_; }
+    void align(int64_t);
+
+    template <typename T>
+    const T* view(int64_t count, int64_t alignment = MAPPED_ARRAY_ALIGNMENT) {
+      align(alignment);
+      const T* ptr = reinterpret_cast<const T*>(file_->data() + tellg());
+      seekg(count * sizeof(T), std::ios_base::cur);
+      if (fail()) {
+        throw std::invalid_argument("Mapped model file is truncated!");
+      }
+      return ptr;
+    }
+};
+
+}
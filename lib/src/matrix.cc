@@ -11,10 +11,12 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <random>
 #include <exception>
 #include <stdexcept>
 
+#include "kernels.h"
 #include "utils.h"
 #include "vector.h"
 
@@ -46,11 +48,14 @@ Matrix& Matrix::operator=(const Matrix& other) {
   m_ = temp.m_;
   n_ = temp.n_;
   std::swap(data_, temp.data_);
+  std::swap(mapping_, temp.mapping_);
   return *this;
 }
 
 Matrix::~Matrix() {
-  delete[] data_;
+  if (!mapping_) {
+    delete[] data_;
+  }
 }
 
 void Matrix::zero() {
@@ -71,23 +76,41 @@ real Matrix::dotRow(const Vector& vec, int64_t i) const {
   assert(i >= 0);
   assert(i < m_);
   assert(vec.size() == n_);
-  real d = 0.0;
-  for (int64_t j = 0; j < n_; j++) {
-    d += at(i, j) * vec.data_[j];
-  }
+  real d = kernels::dot(data_ + i * n_, vec.data_, n_);
   if (std::isnan(d)) {
     throw std::runtime_error("Encountered NaN.");
   }
   return d;
 }
 
+void Matrix::mulBatch(const std::vector<const Vector*>& vecs,
+                      const std::vector<Vector*>& out) const {
+  assert(vecs.size() == out.size());
+  const int64_t block = std::max<int64_t>(
+      1, BATCH_BLOCK_BYTES / (n_ * sizeof(real)));
+  for (int64_t ib = 0; ib < m_; ib += block) {
+    const int64_t ie = std::min(ib + block, m_);
+    for (size_t b = 0; b < vecs.size(); b++) {
+      assert(vecs[b]->size() == n_);
+      assert(out[b]->size() == m_);
+      const real* vec = vecs[b]->data_;
+      real* dst = out[b]->data_;
+      for (int64_t i = ib; i < ie; i++) {
+        real d = kernels::dot(data_ + i * n_, vec, n_);
+        if (std::isnan(d)) {
+          throw std::runtime_error("Encountered NaN.");
+        }
+        dst[i] = d;
+      }
+    }
+  }
+}
+
 void Matrix::addRow(const Vector& vec, int64_t i, real a) {
   assert(i >= 0);
   assert(i < m_);
   assert(vec.size() == n_);
-  for (int64_t j = 0; j < n_; j++) {
-    data_[i * n_ + j] += a * vec.data_[j];
-  }
+  kernels::axpy(data_ + i * n_, vec.data_, a, n_);
 }
 
 void Matrix::multiplyRow(const Vector& nums, int64_t ib, int64_t ie) {
@@ -144,9 +167,30 @@ void Matrix::save(std::ostream& out) {
 void Matrix::load(std::istream& in) {
   in.read((char*) &m_, sizeof(int64_t));
   in.read((char*) &n_, sizeof(int64_t));
-  delete[] data_;
+  if (!mapping_) {
+    delete[] data_;
+  }
+  mapping_.reset();
   data_ = new real[m_ * n_];
   in.read((char*) data_, m_ * n_ * sizeof(real));
 }
 
+void Matrix::saveMapped(std::ostream& out) const {
+  out.write((char*) &m_, sizeof(int64_t));
+  out.write((char*) &n_, sizeof(int64_t));
+  utils::pad(out, MAPPED_PAGE_SIZE);
+  out.write((char*) data_, m_ * n_ * sizeof(real));
+}
+
+void Matrix::loadMapped(MappedStream& in) {
+  in.read((char*) &m_, sizeof(int64_t));
+  in.read((char*) &n_, sizeof(int64_t));
+  if (!mapping_) {
+    delete[] data_;
+  }
+  // mapped read-only: the model must not be trained further
+  data_ = const_cast<real*>(in.view<real>(m_ * n_, MAPPED_PAGE_SIZE));
+  mapping_ = in.file();
+}
+
 }
@@ -11,8 +11,11 @@
 
 #include <cstdint>
 #include <istream>
+#include <memory>
 #include <ostream>
+#include <vector>
 
+#include "mappedfile.h"
 #include "real.h"
 
 namespace fasttext {
@@ -21,6 +24,13 @@ class Vector;
 
 class Matrix {
 
+  protected:
+    // set when data_ points into a mapped file instead of owned memory
+    std::shared_ptr<const MappedFile> mapping_;
+
+    // rows multiplied together by mulBatch, sized to stay in L1
+    static const int64_t BATCH_BLOCK_BYTES = 32 * 1024;
+
   public:
     real* data_;
     int64_t m_;
@@ -39,6 +49,10 @@ class Matrix {
     void zero();
     void uniform(real);
     real dotRow(const Vector&, int64_t) const;
+    // out[b] = this * vecs[b] for every b, one cache-sized block of rows at
+    // a time, so the matrix is read from memory once for the whole batch
+    void mulBatch(const std::vector<const Vector*>& vecs,
+                  const std::vector<Vector*>& out) const;
     void addRow(const Vector&, int64_t, real);
 
     void multiplyRow(const Vector& nums, int64_t ib = 0, int64_t ie = -1);
@@ -49,6 +63,8 @@ class Matrix {
 
     void save(std::ostream&);
     void load(std::istream&);
+    void saveMapped(std::ostream&) const;
+    void loadMapped(MappedStream&);
 };
 
 }
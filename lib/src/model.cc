@@ -12,6 +12,7 @@
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
+#include <limits>
 #include <stdexcept>
 
 namespace fasttext {
@@ -24,10 +25,12 @@ Model::Model(
     std::shared_ptr<Matrix> wi,
     std::shared_ptr<Matrix> wo,
     std::shared_ptr<Args> args,
-    int32_t seed)
-    : hidden_(args->dim),
-      output_(wo->m_),
-      grad_(args->dim),
+    int32_t seed,
+    bool inference)
+    : hidden_(inference ? 0 : args->dim),
+      output_(inference ? 0 : wo->m_),
+      grad_(inference ? 0 : args->dim),
+      inference_(inference),
       rng(seed),
       quant_(false) {
   wi_ = wi;
@@ -95,6 +98,10 @@ void Model::computeOutputSoftmax(Vector& hidden, Vector& output) const {
   } else {
     output.mul(*wo_, hidden);
   }
+  normalizeOutput(output);
+}
+
+void Model::normalizeOutput(Vector& output) const {
   real max = output[0], z = 0.0;
   for (int32_t i = 0; i < osz_; i++) {
     max = std::max(output[i], max);
@@ -144,7 +151,13 @@ bool Model::comparePairs(const std::pair<real, int32_t> &l,
 
 void Model::predict(const std::vector<int32_t>& input, int32_t k,
                     std::vector<std::pair<real, int32_t>>& heap,
-                    Vector& hidden, Vector& output) const {
+                    Vector& hidden, Vector& output, real threshold) const {
+  computeHidden(input, hidden);
+  predict(k, heap, hidden, output, threshold);
+}
+
+void Model::predict(int32_t k, std::vector<std::pair<real, int32_t>>& heap,
+                    Vector& hidden, Vector& output, real threshold) const {
   if (k <= 0) {
     throw std::invalid_argument("k needs to be 1 or higher!");
   }
@@ -152,39 +165,98 @@ void Model::predict(const std::vector<int32_t>& input, int32_t k,
     throw std::invalid_argument("Model needs to be supervised for prediction!");
   }
   heap.reserve(k + 1);
-  computeHidden(input, hidden);
   if (args_->loss == loss_name::hs) {
-    dfs(k, 2 * osz_ - 2, 0.0, heap, hidden);
+    // no threshold keeps every leaf, even below the std_log floor
+    real minScore = threshold > 0 ? std_log(threshold)
+                                  : -std::numeric_limits<real>::infinity();
+    dfs(k, minScore, 2 * osz_ - 2, 0.0, heap, hidden);
   } else {
-    findKBest(k, heap, hidden, output);
+    findKBest(k, threshold, heap, hidden, output);
   }
   std::sort_heap(heap.begin(), heap.end(), comparePairs);
 }
 
+void Model::predictBatch(const std::vector<int32_t>& k,
+                         const std::vector<real>& threshold,
+                         const std::vector<std::vector<std::pair<real, int32_t>>*>& heaps,
+                         const std::vector<Vector*>& hidden,
+                         const std::vector<Vector*>& output) const {
+  assert(k.size() == threshold.size());
+  assert(k.size() == heaps.size());
+  assert(k.size() == hidden.size());
+  assert(k.size() == output.size());
+  if (args_->loss == loss_name::hs || (quant_ && args_->qout)) {
+    // nothing to share: the tree walk and the quantized rows are per vector
+    for (size_t b = 0; b < k.size(); b++) {
+      predict(k[b], *heaps[b], *hidden[b], *output[b], threshold[b]);
+    }
+    return;
+  }
+  for (size_t b = 0; b < k.size(); b++) {
+    if (k[b] <= 0) {
+      throw std::invalid_argument("k needs to be 1 or higher!");
+    }
+  }
+  if (args_->model != model_name::sup) {
+    throw std::invalid_argument("Model needs to be supervised for prediction!");
+  }
+  std::vector<const Vector*> in(hidden.begin(), hidden.end());
+  wo_->mulBatch(in, output);
+  for (size_t b = 0; b < k.size(); b++) {
+    normalizeOutput(*output[b]);
+    heaps[b]->reserve(k[b] + 1);
+    selectKBest(k[b], threshold[b], *heaps[b], *output[b]);
+    std::sort_heap(heaps[b]->begin(), heaps[b]->end(), comparePairs);
+  }
+}
+
 void Model::predict(const std::vector<int32_t>& input, int32_t k,
                     std::vector<std::pair<real, int32_t>>& heap) {
+  if (inference_) {
+    throw std::logic_error("Inference-only model needs caller buffers!");
+  }
   predict(input, k, heap, hidden_, output_);
 }
 
-void Model::findKBest(int32_t k, std::vector<std::pair<real, int32_t>>& heap,
+void Model::findKBest(int32_t k, real threshold,
+                      std::vector<std::pair<real, int32_t>>& heap,
                       Vector& hidden, Vector& output) const {
   computeOutputSoftmax(hidden, output);
+  selectKBest(k, threshold, heap, output);
+}
+
+void Model::selectKBest(int32_t k, real threshold,
+                        std::vector<std::pair<real, int32_t>>& heap,
+                        const Vector& output) const {
+  // the heap holds probabilities until the k best are known: std_log is
+  // monotonic, so only those k need it
   for (int32_t i = 0; i < osz_; i++) {
-    if (heap.size() == k && std_log(output[i]) < heap.front().first) {
+    if (output[i] < threshold) {
       continue;
     }
-    heap.push_back(std::make_pair(std_log(output[i]), i));
+    if (heap.size() == k && output[i] < heap.front().first) {
+      continue;
+    }
+    heap.push_back(std::make_pair(output[i], i));
     std::push_heap(heap.begin(), heap.end(), comparePairs);
     if (heap.size() > k) {
       std::pop_heap(heap.begin(), heap.end(), comparePairs);
       heap.pop_back();
     }
   }
+  for (auto& pair : heap) {
+    pair.first = std_log(pair.first);
+  }
 }
 
-void Model::dfs(int32_t k, int32_t node, real score,
+void Model::dfs(int32_t k, real minScore, int32_t node, real score,
                 std::vector<std::pair<real, int32_t>>& heap,
                 Vector& hidden) const {
+  // scores only decrease down the tree: no leaf below can reach the
+  // threshold, or beat the k-th best
+  if (score < minScore) {
+    return;
+  }
   if (heap.size() == k && score < heap.front().first) {
     return;
   }
@@ -207,13 +279,16 @@ void Model::dfs(int32_t k, int32_t node, real score,
   }
   f = 1. / (1 + std::exp(-f));
 
-  dfs(k, tree[node].left, score + std_log(1.0 - f), heap, hidden);
-  dfs(k, tree[node].right, score + std_log(f), heap, hidden);
+  dfs(k, minScore, tree[node].left, score + std_log(1.0 - f), heap, hidden);
+  dfs(k, minScore, tree[node].right, score + std_log(f), heap, hidden);
 }
 
 void Model::update(const std::vector<int32_t>& input, int32_t target, real lr) {
   assert(target >= 0);
   assert(target < osz_);
+  if (inference_) {
+    throw std::logic_error("Inference-only model cannot be trained!");
+  }
   if (input.size() == 0) return;
   computeHidden(input, hidden_);
   if (args_->loss == loss_name::ns) {
@@ -235,7 +310,7 @@ void Model::update(const std::vector<int32_t>& input, int32_t target, real lr) {
 
 void Model::setTargetCounts(const std::vector<int64_t>& counts) {
   assert(counts.size() == osz_);
-  if (args_->loss == loss_name::ns) {
+  if (args_->loss == loss_name::ns && !inference_) {
     initTableNegatives(counts);
   }
   if (args_->loss == loss_name::hs) {
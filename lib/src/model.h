@@ -53,11 +53,16 @@ class Model {
     std::vector< std::vector<int32_t> > paths;
     std::vector< std::vector<bool> > codes;
     std::vector<Node> tree;
+    // inference-only models have no training buffers and no negatives table
+    bool inference_;
 
     static bool comparePairs(const std::pair<real, int32_t>&,
                              const std::pair<real, int32_t>&);
 
     int32_t getNegative(int32_t target);
+    void normalizeOutput(Vector&) const;
+    void selectKBest(int32_t, real, std::vector<std::pair<real, int32_t>>&,
+                     const Vector&) const;
     void initSigmoid();
     void initLog();
 
@@ -65,22 +70,35 @@ class Model {
 
   public:
     Model(std::shared_ptr<Matrix>, std::shared_ptr<Matrix>,
-          std::shared_ptr<Args>, int32_t);
+          std::shared_ptr<Args>, int32_t, bool inference = false);
 
     real binaryLogistic(int32_t, bool, real);
     real negativeSampling(int32_t, real);
     real hierarchicalSoftmax(int32_t, real);
     real softmax(int32_t, real);
 
+    // the threshold drops labels of a lower probability, and prunes the
+    // search: softmax skips them, hs cuts the subtrees below it
     void predict(const std::vector<int32_t>&, int32_t,
                  std::vector<std::pair<real, int32_t>>&,
-                 Vector&, Vector&) const;
+                 Vector&, Vector&, real threshold = 0.0) const;
     void predict(const std::vector<int32_t>&, int32_t,
                  std::vector<std::pair<real, int32_t>>&);
-    void dfs(int32_t, int32_t, real,
+    // predicts from a hidden vector already computed by the caller
+    void predict(int32_t, std::vector<std::pair<real, int32_t>>&,
+                 Vector&, Vector&, real threshold = 0.0) const;
+    // predicts for several hidden vectors at once, reading the output
+    // matrix a single time for all of them
+    void predictBatch(const std::vector<int32_t>&,
+                      const std::vector<real>&,
+                      const std::vector<std::vector<std::pair<real, int32_t>>*>&,
+                      const std::vector<Vector*>&,
+                      const std::vector<Vector*>&) const;
+    // minScore is the log of the threshold
+    void dfs(int32_t, real, int32_t, real,
              std::vector<std::pair<real, int32_t>>&,
              Vector&) const;
-    void findKBest(int32_t, std::vector<std::pair<real, int32_t>>&,
+    void findKBest(int32_t, real, std::vector<std::pair<real, int32_t>>&,
                    Vector&, Vector&) const;
     void update(const std::vector<int32_t>&, int32_t, real);
     void computeHidden(const std::vector<int32_t>&, Vector&) const;
@@ -12,6 +12,8 @@
 #include <assert.h>
 #include <iostream>
 
+#include "utils.h"
+
 namespace fasttext {
 
 QMatrix::QMatrix() : qnorm_(false),
@@ -32,6 +34,9 @@ QMatrix::QMatrix(const Matrix& mat, int32_t dsub, bool qnorm)
 }
 
 QMatrix::~QMatrix() {
+  if (mapping_) {
+    return;
+  }
   if (codesize_ > 0) {
     delete[] codes_;
   }
@@ -118,4 +123,36 @@ void QMatrix::load(std::istream& in) {
     }
 }
 
+void QMatrix::saveMapped(std::ostream& out) {
+    out.write((char*) &qnorm_, sizeof(qnorm_));
+    out.write((char*) &m_, sizeof(m_));
+    out.write((char*) &n_, sizeof(n_));
+    out.write((char*) &codesize_, sizeof(codesize_));
+    pq_->save(out);
+    if (qnorm_) {
+      npq_->save(out);
+      utils::pad(out, MAPPED_ARRAY_ALIGNMENT);
+      out.write((char*) norm_codes_, m_ * sizeof(uint8_t));
+    }
+    utils::pad(out, MAPPED_PAGE_SIZE);
+    out.write((char*) codes_, codesize_ * sizeof(uint8_t));
+}
+
+void QMatrix::loadMapped(MappedStream& in) {
+    in.read((char*) &qnorm_, sizeof(qnorm_));
+    in.read((char*) &m_, sizeof(m_));
+    in.read((char*) &n_, sizeof(n_));
+    in.read((char*) &codesize_, sizeof(codesize_));
+    pq_ = std::unique_ptr<ProductQuantizer>( new ProductQuantizer());
+    pq_->load(in);
+    if (qnorm_) {
+      npq_ = std::unique_ptr<ProductQuantizer>( new ProductQuantizer());
+      npq_->load(in);
+      norm_codes_ = const_cast<uint8_t*>(in.view<uint8_t>(m_));
+    }
+    codes_ = const_cast<uint8_t*>(
+        in.view<uint8_t>(codesize_, MAPPED_PAGE_SIZE));
+    mapping_ = in.file();
+}
+
 }
@@ -18,6 +18,7 @@
 
 #include "real.h"
 
+#include "mappedfile.h"
 #include "matrix.h"
 #include "vector.h"
 
@@ -40,6 +41,9 @@ class QMatrix {
 
     int32_t codesize_;
 
+    // set when the codes point into a mapped file instead of owned memory
+    std::shared_ptr<const MappedFile> mapping_;
+
   public:
 
     QMatrix();
@@ -57,6 +61,8 @@ class QMatrix {
 
     void save(std::ostream&);
     void load(std::istream&);
+    void saveMapped(std::ostream&);
+    void loadMapped(MappedStream&);
 };
 
 }
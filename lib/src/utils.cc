@@ -24,6 +24,13 @@ namespace utils {
     ifs.clear();
     ifs.seekg(std::streampos(pos));
   }
+
+  void pad(std::ostream& out, int64_t alignment) {
+    int64_t rem = int64_t(out.tellp()) % alignment;
+    for (int64_t i = 0; rem != 0 && i < alignment - rem; i++) {
+      out.put(0);
+    }
+  }
 }
 
 }
@@ -25,6 +25,7 @@ namespace utils {
 
   int64_t size(std::ifstream&);
   void seek(std::ifstream&, int64_t);
+  void pad(std::ostream&, int64_t);
 }
 
 }
@@ -14,6 +14,7 @@
 #include <iomanip>
 #include <cmath>
 
+#include "kernels.h"
 #include "matrix.h"
 #include "qmatrix.h"
 
@@ -70,18 +71,14 @@ void Vector::addRow(const Matrix& A, int64_t i) {
   assert(i >= 0);
   assert(i < A.m_);
   assert(m_ == A.n_);
-  for (int64_t j = 0; j < A.n_; j++) {
-    data_[j] += A.at(i, j);
-  }
+  kernels::add(data_, A.data_ + i * A.n_, A.n_);
 }
 
 void Vector::addRow(const Matrix& A, int64_t i, real a) {
   assert(i >= 0);
   assert(i < A.m_);
   assert(m_ == A.n_);
-  for (int64_t j = 0; j < A.n_; j++) {
-    data_[j] += a * A.at(i, j);
-  }
+  kernels::axpy(data_, A.data_ + i * A.n_, a, A.n_);
 }
 
 void Vector::addRow(const QMatrix& A, int64_t i) {
@@ -0,0 +1,38 @@
+
+#include "buildIndexWorker.h"
+#include <v8.h>
+
+void BuildIndexWorker::Execute () {
+    try {
+        wrapper_->loadModel(false);
+        wrapper_->precomputeWordVectors();
+        wrapper_->buildIndex(M_, efConstruction_, threads_);
+    } catch (std::string errorMessage) {
+        this->SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        this->SetErrorMessage(str);
+    } catch (const std::exception& e) {
+        this->SetErrorMessage(e.what());
+    }
+}
+
+
+void BuildIndexWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage())
+    };
+
+    callback->Call(1, argv);
+}
+
+void BuildIndexWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null()
+    };
+
+    callback->Call(1, argv);
+}
@@ -0,0 +1,30 @@
+#ifndef BUILD_INDEX_WORKER_H
+#define BUILD_INDEX_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class BuildIndexWorker : public Nan::AsyncWorker {
+    public:
+        BuildIndexWorker (Nan::Callback *callback, int32_t M, int32_t efConstruction,
+                int32_t threads, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                M_(M),
+                efConstruction_(efConstruction),
+                threads_(threads),
+                wrapper_(wrapper) {};
+
+        ~BuildIndexWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        int32_t M_;
+        int32_t efConstruction_;
+        int32_t threads_;
+        std::shared_ptr<Wrapper> wrapper_;
+};
+
+#endif
@@ -6,10 +6,12 @@
 #include <node_object_wrap.h>
 #include <nan.h>
 
-#include "wrapper.h"
+#include "modelObject.h"
 #include "classifierWorker.h"
+#include "classifierBatchWorker.h"
+#include "predictFileWorker.h"
 
-class Classifier : public Nan::ObjectWrap {
+class Classifier : public ModelObject {
     public:
         static NAN_MODULE_INIT(Init) {
             v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
@@ -17,6 +19,15 @@ class Classifier : public Nan::ObjectWrap {
             tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
             Nan::SetPrototypeMethod(tpl, "predict", Predict);
+            Nan::SetPrototypeMethod(tpl, "predictBatch", PredictBatch);
+            Nan::SetPrototypeMethod(tpl, "predictFile", PredictFile);
+            Nan::SetPrototypeMethod(tpl, "setBatching", SetBatching);
+            Nan::SetPrototypeMethod(tpl, "train", Train);
+            Nan::SetPrototypeMethod(tpl, "saveModel", SaveModel);
+            Nan::SetPrototypeMethod(tpl, "load", Load);
+            Nan::SetPrototypeMethod(tpl, "reload", Reload);
+            Nan::SetPrototypeMethod(tpl, "setCache", SetCache);
+            Nan::SetPrototypeMethod(tpl, "cacheStats", GetCacheStats);
 
             constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
             Nan::Set(target, Nan::New("Classifier").ToLocalChecked(),
@@ -25,7 +36,7 @@ class Classifier : public Nan::ObjectWrap {
 
     private:
         explicit Classifier(std::string modelFilename) :
-            wrapper_(new Wrapper(modelFilename))
+            ModelObject(modelFilename, true)
             {}
 
         ~Classifier() {}
@@ -54,8 +65,9 @@ class Classifier : public Nan::ObjectWrap {
 
 
         static NAN_METHOD(Predict) {
-            if (!info[0]->IsString()) {
-                Nan::ThrowError("sentence must be a string");
+            bool isBuffer = node::Buffer::HasInstance(info[0]);
+            if (!info[0]->IsString() && !isBuffer) {
+                Nan::ThrowError("sentence must be a string or a Buffer");
                 return;
             }
 
@@ -64,29 +76,225 @@ class Classifier : public Nan::ObjectWrap {
                 return;
             }
 
-            if (!info[2]->IsFunction()) {
+            // the threshold is optional: predict(sentence, k, [threshold], callback)
+            int callbackIndex = 2;
+            real threshold = 0.0;
+            if (info[2]->IsNumber()) {
+                threshold = Nan::To<double>(info[2]).FromJust();
+                callbackIndex = 3;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
                 Nan::ThrowError("callback must be a function");
                 return;
             }
 
             // int32_t k = info[1]->ToLocalChecked()->Uint32Value();
             int32_t k = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
-            // v8::String::Utf8Value sentenceArg(info[0]->ToString());
-            Nan::Utf8String sentenceArg(info[0]);
-            std::string sentence = std::string(*sentenceArg);
-            Nan::Callback *callback = new Nan::Callback(info[2].As<v8::Function>());
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            Classifier* obj = Nan::ObjectWrap::Unwrap<Classifier>(info.Holder());
+
+            ClassifierWorker* worker;
+            if (isBuffer) {
+                // the bytes are tokenized in place: the Buffer is kept alive
+                // by the worker instead of being copied
+                worker = new ClassifierWorker(callback, node::Buffer::Data(info[0]),
+                    node::Buffer::Length(info[0]), k, threshold, obj->wrapper_);
+                worker->SaveToPersistent("buffer", info[0]);
+            } else {
+                // v8::String::Utf8Value sentenceArg(info[0]->ToString());
+                Nan::Utf8String sentenceArg(info[0]);
+                std::string sentence = std::string(*sentenceArg);
+                worker = new ClassifierWorker(callback, sentence, k, threshold, obj->wrapper_);
+            }
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::INTERACTIVE);
+        }
+
+        static NAN_METHOD(PredictBatch) {
+            if (!info[0]->IsArray()) {
+                Nan::ThrowError("sentences must be an array");
+                return;
+            }
+
+            if (!info[1]->IsUint32()) {
+                Nan::ThrowError("k must be a number");
+                return;
+            }
+
+            // predictBatch(sentences, k, [threads | { threads, threshold }], callback)
+            int callbackIndex = 2;
+            int32_t threads = 1;
+            real threshold = 0.0;
+            if (info[2]->IsUint32()) {
+                threads = info[2]->Int32Value(Nan::GetCurrentContext()).FromJust();
+                callbackIndex = 3;
+            } else if (info[2]->IsObject() && !info[2]->IsFunction()) {
+                v8::Local<v8::Object> options = info[2].As<v8::Object>();
+                try {
+                    threads = IntOption(options, "threads", threads);
+                    threshold = NumberOption(options, "threshold", threshold);
+                } catch (std::string errorMessage) {
+                    Nan::ThrowError(errorMessage.c_str());
+                    return;
+                }
+                callbackIndex = 3;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            int32_t k = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+            v8::Local<v8::Array> sentencesArg = info[0].As<v8::Array>();
+            std::vector<std::string> sentences;
+            sentences.reserve(sentencesArg->Length());
+
+            for (uint32_t i = 0; i < sentencesArg->Length(); i++) {
+                v8::Local<v8::Value> sentence = Nan::Get(sentencesArg, i).ToLocalChecked();
+                if (!sentence->IsString()) {
+                    Nan::ThrowError("sentences must contain only strings");
+                    return;
+                }
+                Nan::Utf8String sentenceArg(sentence);
+                sentences.push_back(std::string(*sentenceArg));
+            }
+
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            Classifier* obj = Nan::ObjectWrap::Unwrap<Classifier>(info.Holder());
+
+            ClassifierBatchWorker* worker = new ClassifierBatchWorker(callback, sentences, k,
+                threshold, threads, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::INTERACTIVE);
+        }
+
+        // predictFile(input, k, [{ threads, chunkSize, threshold, output, onChunk }], callback)
+        // writes the predictions to `output`, or passes them to
+        // onChunk(results, firstLine) in file order
+        static NAN_METHOD(PredictFile) {
+            if (!info[0]->IsString()) {
+                Nan::ThrowError("input must be a string");
+                return;
+            }
+
+            if (!info[1]->IsUint32()) {
+                Nan::ThrowError("k must be a number");
+                return;
+            }
+
+            int callbackIndex = 2;
+            int32_t threads = 1;
+            int32_t chunkLines = 1024;
+            real threshold = 0.0;
+            std::string output;
+            Nan::Callback *onChunk = NULL;
+            if (info[2]->IsObject() && !info[2]->IsFunction()) {
+                v8::Local<v8::Object> options = info[2].As<v8::Object>();
+                try {
+                    threads = IntOption(options, "threads", threads);
+                    chunkLines = IntOption(options, "chunkSize", chunkLines);
+                    threshold = NumberOption(options, "threshold", threshold);
+                } catch (std::string errorMessage) {
+                    Nan::ThrowError(errorMessage.c_str());
+                    return;
+                }
+
+                v8::Local<v8::Value> outputArg =
+                    Nan::Get(options, Nan::New("output").ToLocalChecked()).ToLocalChecked();
+                if (outputArg->IsString()) {
+                    Nan::Utf8String outputPath(outputArg);
+                    output = std::string(*outputPath);
+                } else if (!outputArg->IsUndefined()) {
+                    Nan::ThrowError("output must be a string");
+                    return;
+                }
+
+                v8::Local<v8::Value> onChunkArg =
+                    Nan::Get(options, Nan::New("onChunk").ToLocalChecked()).ToLocalChecked();
+                if (onChunkArg->IsFunction()) {
+                    onChunk = new Nan::Callback(onChunkArg.As<v8::Function>());
+                } else if (!onChunkArg->IsUndefined()) {
+                    Nan::ThrowError("onChunk must be a function");
+                    return;
+                }
+                callbackIndex = 3;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                delete onChunk;
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            if (output.empty() == (onChunk == NULL)) {
+                delete onChunk;
+                Nan::ThrowError("either output or onChunk must be given, not both");
+                return;
+            }
+
+            int32_t k = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+            Nan::Utf8String inputArg(info[0]);
+            std::string input = std::string(*inputArg);
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
 
             Classifier* obj = Nan::ObjectWrap::Unwrap<Classifier>(info.Holder());
 
-            Nan::AsyncQueueWorker(new ClassifierWorker(callback, sentence, k, obj->wrapper_));
+            PredictFileWorker* worker = new PredictFileWorker(callback, onChunk, input,
+                output, k, threshold, threads, chunkLines, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        // train(options, [onProgress], callback) trains a supervised model
+        static NAN_METHOD(Train) {
+            std::vector<std::string> args;
+            std::string model = "supervised";
+            if (!TrainArguments(info, args, model)) {
+                return;
+            }
+            if (model != "supervised") {
+                Nan::ThrowError("model of a Classifier must be supervised");
+                return;
+            }
+            QueueTrain(info, model, args);
+        }
+
+        // setBatching({ maxBatch, window }) lets up to maxBatch concurrent
+        // predict calls, gathered for at most window microseconds, share one
+        // pass over the output matrix
+        static NAN_METHOD(SetBatching) {
+            if (!info[0]->IsObject()) {
+                Nan::ThrowError("options argument must be an object.");
+                return;
+            }
+            v8::Local<v8::Object> options = info[0].As<v8::Object>();
+
+            int32_t maxBatch = 32;
+            int32_t window = 200;
+            try {
+                maxBatch = IntOption(options, "maxBatch", maxBatch);
+                window = IntOption(options, "window", window);
+            } catch (std::string errorMessage) {
+                Nan::ThrowError(errorMessage.c_str());
+                return;
+            }
+            if (maxBatch < 1) {
+                Nan::ThrowError("maxBatch must be 1 or higher");
+                return;
+            }
+
+            Classifier* obj = Nan::ObjectWrap::Unwrap<Classifier>(info.Holder());
+            obj->wrapper_->setBatching(maxBatch, window);
         }
 
         static inline Nan::Persistent<v8::Function> & constructor() {
             static Nan::Persistent<v8::Function> my_constructor;
             return my_constructor;
         }
-
-        Wrapper* wrapper_;
     };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+
+#include "classifierBatchWorker.h"
+#include <v8.h>
+
+void ClassifierBatchWorker::Execute () {
+    try {
+        wrapper_->loadModel();
+        wrapper_->precomputeSubwords();
+        result_ = wrapper_->predictBatch(sentences_, k_, threads_, threshold_);
+    } catch (std::string errorMessage) {
+        SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        SetErrorMessage(str);
+    } catch(const std::exception& e) {
+        SetErrorMessage(e.what());
+    }
+}
+
+
+void ClassifierBatchWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage()),
+        Nan::Null()
+    };
+
+    callback->Call(2, argv);
+}
+
+void ClassifierBatchWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+    v8::Local<v8::Array> result = Nan::New<v8::Array>(result_.size());
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    v8::Local<v8::Context> context =isolate->GetCurrentContext();
+
+    for(unsigned int s = 0; s < result_.size(); s++) {
+        const std::vector<PredictResult>& predictions = result_[s];
+        v8::Local<v8::Array> sentenceResult = Nan::New<v8::Array>(predictions.size());
+
+        for(unsigned int i = 0; i < predictions.size(); i++) {
+            v8::Local<v8::Object> returnObject = Nan::New<v8::Object>();
+
+            returnObject->Set(
+                context,
+                Nan::New<v8::String>("label").ToLocalChecked(),
+                Nan::New<v8::String>(predictions[i].label.c_str()).ToLocalChecked()
+            );
+
+            returnObject->Set(
+                context,
+                Nan::New<v8::String>("value").ToLocalChecked(),
+                Nan::New<v8::Number>(predictions[i].value)
+            );
+
+            sentenceResult->Set(context, i, returnObject);
+        }
+
+        result->Set(context, s, sentenceResult);
+    }
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null(),
+        result
+    };
+
+    callback->Call(2, argv);
+}
@@ -0,0 +1,34 @@
+#ifndef CLASSIFIER_BATCH_WORKER_H
+#define CLASSIFIER_BATCH_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class ClassifierBatchWorker : public Nan::AsyncWorker {
+    public:
+        ClassifierBatchWorker (Nan::Callback *callback, std::vector<std::string> sentences,
+                int32_t k, real threshold, int32_t threads, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                sentences_(sentences),
+                wrapper_(wrapper),
+                result_(),
+                k_(k),
+                threshold_(threshold),
+                threads_(threads) {};
+
+        ~ClassifierBatchWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        std::vector<std::string> sentences_;
+        std::shared_ptr<Wrapper> wrapper_;
+        std::vector<std::vector<PredictResult>> result_;
+        int32_t k_;
+        real threshold_;
+        int32_t threads_;
+};
+
+#endif
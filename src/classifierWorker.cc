@@ -6,7 +6,12 @@
 void ClassifierWorker::Execute () {
     try {
         wrapper_->loadModel();
-        result_ = wrapper_->predict(sentence_, k_);
+        wrapper_->precomputeSubwords();
+        if (data_) {
+            result_ = wrapper_->predict(data_, length_, k_, threshold_);
+        } else {
+            result_ = wrapper_->predict(sentence_, k_, threshold_);
+        }
     } catch (std::string errorMessage) {
         SetErrorMessage(errorMessage.c_str());
     } catch (const char * str) {
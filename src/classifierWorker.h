@@ -7,12 +7,27 @@
 
 class ClassifierWorker : public Nan::AsyncWorker {
     public:
-        ClassifierWorker (Nan::Callback *callback, std::string sentence, int32_t k, Wrapper *wrapper)
+        ClassifierWorker (Nan::Callback *callback, std::string sentence, int32_t k, real threshold, std::shared_ptr<Wrapper> wrapper)
             : Nan::AsyncWorker(callback),
                 sentence_(sentence),
+                data_(nullptr),
+                length_(0),
                 wrapper_(wrapper),
                 result_(),
-                k_(k) {};
+                k_(k),
+                threshold_(threshold) {};
+
+        // reads the bytes in place: they must outlive the worker, which the
+        // caller ensures by saving their Buffer to persistent
+        ClassifierWorker (Nan::Callback *callback, const char* data, size_t length, int32_t k, real threshold, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                sentence_(),
+                data_(data),
+                length_(length),
+                wrapper_(wrapper),
+                result_(),
+                k_(k),
+                threshold_(threshold) {};
 
         ~ClassifierWorker () {};
 
@@ -22,9 +37,12 @@ class ClassifierWorker : public Nan::AsyncWorker {
 
     private:
         std::string sentence_;
-        Wrapper *wrapper_;
+        const char* data_;
+        size_t length_;
+        std::shared_ptr<Wrapper> wrapper_;
         std::vector<PredictResult> result_;
         int32_t k_;
+        real threshold_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+
+#include "evaluateIndexWorker.h"
+#include <v8.h>
+
+void EvaluateIndexWorker::Execute () {
+    try {
+        wrapper_->loadModel(false);
+        wrapper_->precomputeWordVectors();
+        result_ = wrapper_->evaluateIndex(samples_, k_, efSearch_, threads_);
+    } catch (std::string errorMessage) {
+        this->SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        this->SetErrorMessage(str);
+    } catch (const std::exception& e) {
+        this->SetErrorMessage(e.what());
+    }
+}
+
+
+void EvaluateIndexWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage()),
+        Nan::Null()
+    };
+
+    callback->Call(2, argv);
+}
+
+void EvaluateIndexWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+    v8::Local<v8::Context> context = Nan::GetCurrentContext();
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("samples").ToLocalChecked(),
+        Nan::New<v8::Number>(result_.samples)
+    );
+    result->Set(
+        context,
+        Nan::New<v8::String>("recall").ToLocalChecked(),
+        Nan::New<v8::Number>(result_.recall)
+    );
+    result->Set(
+        context,
+        Nan::New<v8::String>("exactMs").ToLocalChecked(),
+        Nan::New<v8::Number>(result_.exactMs)
+    );
+    result->Set(
+        context,
+        Nan::New<v8::String>("approximateMs").ToLocalChecked(),
+        Nan::New<v8::Number>(result_.approximateMs)
+    );
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null(),
+        result
+    };
+
+    callback->Call(2, argv);
+}
@@ -0,0 +1,34 @@
+#ifndef EVALUATE_INDEX_WORKER_H
+#define EVALUATE_INDEX_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class EvaluateIndexWorker : public Nan::AsyncWorker {
+    public:
+        EvaluateIndexWorker (Nan::Callback *callback, int32_t samples, int32_t k,
+                int32_t efSearch, int32_t threads, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                samples_(samples),
+                k_(k),
+                efSearch_(efSearch),
+                threads_(threads),
+                wrapper_(wrapper),
+                result_() {};
+
+        ~EvaluateIndexWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        int32_t samples_;
+        int32_t k_;
+        int32_t efSearch_;
+        int32_t threads_;
+        std::shared_ptr<Wrapper> wrapper_;
+        IndexEvaluation result_;
+};
+
+#endif
@@ -1,11 +1,63 @@
-
 #include <nan.h>
 #include "classifier.h"   // NOLINT(build/include)
 #include "query.h"   // NOLINT(build/include)
+#include "mapModelWorker.h"   // NOLINT(build/include)
+#include "workerPool.h"   // NOLINT(build/include)
+
+NAN_METHOD(MapModel) {
+  if (!info[0]->IsString() || !info[1]->IsString()) {
+    Nan::ThrowError("source and target must be strings");
+    return;
+  }
+
+  if (!info[2]->IsFunction()) {
+    Nan::ThrowError("callback must be a function");
+    return;
+  }
+
+  Nan::Utf8String sourceArg(info[0]);
+  Nan::Utf8String targetArg(info[1]);
+  Nan::Callback *callback = new Nan::Callback(info[2].As<v8::Function>());
+
+  WorkerPool::queue(new MapModelWorker(callback,
+    std::string(*sourceArg), std::string(*targetArg)), WorkerPool::BULK);
+}
+
+// setThreadPool({ interactive, bulk }) sizes the native worker threads, it
+// has to run before the first job of each kind
+NAN_METHOD(SetThreadPool) {
+  if (!info[0]->IsObject()) {
+    Nan::ThrowError("options argument must be an object.");
+    return;
+  }
+  v8::Local<v8::Object> options = info[0].As<v8::Object>();
+  const char* names[] = { "interactive", "bulk" };
+  const WorkerPool::Queue queues[] = { WorkerPool::INTERACTIVE, WorkerPool::BULK };
+
+  for (int i = 0; i < 2; i++) {
+    v8::Local<v8::Value> value =
+      Nan::Get(options, Nan::New(names[i]).ToLocalChecked()).ToLocalChecked();
+    if (value->IsUndefined()) {
+      continue;
+    }
+    if (!value->IsUint32()) {
+      Nan::ThrowError((std::string(names[i]) + " must be a number").c_str());
+      return;
+    }
+    try {
+      WorkerPool::configure(queues[i], Nan::To<int32_t>(value).FromJust());
+    } catch (const std::exception& e) {
+      Nan::ThrowError(e.what());
+      return;
+    }
+  }
+}
 
 NAN_MODULE_INIT(Init) {
   Classifier::Init(target);
   Query::Init(target);
+  Nan::SetMethod(target, "mapModel", MapModel);
+  Nan::SetMethod(target, "setThreadPool", SetThreadPool);
 }
 
-NODE_MODULE(myaddon, Init)
\ No newline at end of file
+NODE_MODULE(myaddon, Init)
@@ -0,0 +1,24 @@
+
+#ifndef FLOAT32_ARRAY_H
+#define FLOAT32_ARRAY_H
+
+#include <nan.h>
+
+#include "../lib/src/real.h"
+
+static_assert(sizeof(fasttext::real) == 4, "Float32Array results need 32 bit reals");
+
+/**
+ * Hands `data`, allocated with new[], over to a Float32Array without copying
+ * it. The memory is freed when the array is garbage collected.
+ */
+inline v8::Local<v8::Float32Array> NewFloat32Array(fasttext::real* data, size_t length) {
+    v8::Local<v8::Object> buffer = Nan::NewBuffer(
+        reinterpret_cast<char*>(data), length * sizeof(fasttext::real),
+        [](char* bytes, void*) { delete[] reinterpret_cast<fasttext::real*>(bytes); },
+        nullptr).ToLocalChecked();
+    v8::Local<v8::Uint8Array> bytes = buffer.As<v8::Uint8Array>();
+    return v8::Float32Array::New(bytes->Buffer(), bytes->ByteOffset(), length);
+}
+
+#endif
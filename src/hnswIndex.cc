@@ -0,0 +1,515 @@
+
+#include "hnswIndex.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "../lib/src/kernels.h"
+#include "../lib/src/utils.h"
+
+#ifdef WIN
+#define stat _stat64
+#endif
+
+using fasttext::Matrix;
+using fasttext::Vector;
+using fasttext::MappedFile;
+using fasttext::MappedStream;
+using fasttext::real;
+
+// levels above this are never drawn, even for huge vocabularies
+constexpr int32_t HNSW_MAX_LEVEL = 16;
+// number of mutexes guarding link blocks while building, a power of 2
+constexpr int32_t HNSW_LOCK_STRIPES = 4096;
+
+namespace {
+
+// per thread marks of the nodes seen by the current search, reset in O(1)
+struct VisitedSet {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+
+    void reset(int32_t n) {
+        if (marks.size() < (size_t) n) {
+            marks.assign(n, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // true when the node was not seen yet
+    bool visit(int32_t node) {
+        if (marks[node] == epoch) {
+            return false;
+        }
+        marks[node] = epoch;
+        return true;
+    }
+};
+
+thread_local VisitedSet visited;
+
+bool better(const std::pair<real, int32_t>& l, const std::pair<real, int32_t>& r) {
+    return l.first > r.first;
+}
+
+bool worse(const std::pair<real, int32_t>& l, const std::pair<real, int32_t>& r) {
+    return l.first < r.first;
+}
+
+}
+
+void stampModel(const std::string& modelFilename, int64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (stat(modelFilename.c_str(), &st) != 0) {
+        throw "Model file cannot be opened for loading!";
+    }
+    size = st.st_size;
+    // in nanoseconds where the platform has them: a model rewritten within
+    // the same second with the same size is still told apart
+#if defined(WIN)
+    mtime = (int64_t) st.st_mtime * 1000000000;
+#elif defined(__APPLE__)
+    mtime = (int64_t) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+HnswIndex::HnswIndex(std::shared_ptr<const Matrix> vectors, int32_t M)
+    : vectors_(vectors),
+        n_(vectors->m_),
+        dim_(vectors->n_),
+        M_(M),
+        maxLevel_(0),
+        entry_(-1),
+        levels_(nullptr),
+        upperOffsets_(nullptr),
+        links0_(nullptr),
+        upper_(nullptr),
+        upperSize_(0) {}
+
+std::string HnswIndex::sidecarPath(const std::string& modelFilename) {
+    return modelFilename + ".hnsw";
+}
+
+const real* HnswIndex::row(int32_t i) const {
+    return vectors_->data_ + (int64_t) i * dim_;
+}
+
+real HnswIndex::similarity(const real* query, int32_t i) const {
+    real dp = fasttext::kernels::dot(query, row(i), dim_);
+    // words without any vector are never close to anything
+    return std::isnan(dp) ? -std::numeric_limits<real>::infinity() : dp;
+}
+
+const int32_t* HnswIndex::links(int32_t node, int32_t level) const {
+    if (level == 0) {
+        return links0_ + (int64_t) node * (1 + maxLinks(0));
+    }
+    return upper_ + upperOffsets_[node] + (int64_t) (level - 1) * (1 + M_);
+}
+
+int32_t* HnswIndex::links(int32_t node, int32_t level) {
+    return const_cast<int32_t*>(
+        static_cast<const HnswIndex*>(this)->links(node, level));
+}
+
+void HnswIndex::copyLinks(int32_t node, int32_t level,
+        std::vector<int32_t>& out) const {
+    std::unique_lock<std::mutex> lock;
+    if (locks_) {
+        lock = std::unique_lock<std::mutex>(
+            locks_[node & (HNSW_LOCK_STRIPES - 1)]);
+    }
+    const int32_t* block = links(node, level);
+    out.assign(block + 1, block + 1 + block[0]);
+}
+
+void HnswIndex::allocate(int32_t efConstruction) {
+    // the same levels are drawn whatever the number of threads
+    std::minstd_rand rng(efConstruction + M_);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double mult = 1.0 / std::log((double) M_);
+
+    ownedLevels_.resize(n_);
+    ownedUpperOffsets_.resize(n_);
+    for (int32_t i = 0; i < n_; i++) {
+        double r = -std::log(1.0 - uniform(rng)) * mult;
+        int32_t level = std::min<int32_t>(HNSW_MAX_LEVEL, (int32_t) r);
+        ownedLevels_[i] = level;
+        ownedUpperOffsets_[i] = upperSize_;
+        upperSize_ += (int64_t) level * (1 + M_);
+    }
+    ownedLinks0_.assign((int64_t) n_ * (1 + maxLinks(0)), 0);
+    ownedUpper_.assign(upperSize_, 0);
+
+    levels_ = ownedLevels_.data();
+    upperOffsets_ = ownedUpperOffsets_.data();
+    links0_ = ownedLinks0_.data();
+    upper_ = ownedUpper_.data();
+}
+
+std::shared_ptr<HnswIndex> HnswIndex::build(std::shared_ptr<const Matrix> vectors,
+        int32_t M, int32_t efConstruction, int32_t threads) {
+    if (M < 2) {
+        throw std::invalid_argument("M must be at least 2");
+    }
+    if (efConstruction < 1) {
+        throw std::invalid_argument("efConstruction must be at least 1");
+    }
+    std::shared_ptr<HnswIndex> index(new HnswIndex(vectors, M));
+    index->allocate(efConstruction);
+    if (index->n_ == 0) {
+        return index;
+    }
+    index->entry_ = 0;
+    index->maxLevel_ = index->levels_[0];
+    index->locks_.reset(new std::mutex[HNSW_LOCK_STRIPES]);
+
+    // nodes are handed out one at a time, so threads stay busy until the end
+    std::atomic<int32_t> next(1);
+    auto work = [&]() {
+        for (int32_t node = next++; node < index->n_; node = next++) {
+            index->insert(node, efConstruction);
+        }
+    };
+    threads = std::max(1, std::min(threads, index->n_));
+    if (threads == 1) {
+        work();
+    } else {
+        std::vector<std::thread> pool;
+        std::vector<std::exception_ptr> errors(threads);
+        for (int32_t t = 0; t < threads; t++) {
+            pool.push_back(std::thread([&, t]() {
+                try {
+                    work();
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                    next = index->n_;
+                }
+            }));
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    index->locks_.reset();
+    return index;
+}
+
+void HnswIndex::insert(int32_t node, int32_t efConstruction) {
+    const real* query = row(node);
+    const int32_t level = levels_[node];
+
+    // a node that becomes the new top level keeps the entry lock until it
+    // is linked, the others only need a consistent snapshot of the entry
+    std::unique_lock<std::mutex> entryLock(entryMtx_);
+    const int32_t maxLevel = maxLevel_;
+    Candidate best(similarity(query, entry_), entry_);
+    if (level <= maxLevel) {
+        entryLock.unlock();
+    }
+
+    greedyClosest(query, best.second, best.first, maxLevel, level);
+    for (int32_t l = std::min(level, maxLevel); l >= 0; l--) {
+        std::vector<Candidate> found = searchLayer(query, best, efConstruction, l);
+        best = found[0];
+        std::vector<Candidate> neighbors = selectNeighbors(found, M_);
+        {
+            std::lock_guard<std::mutex> lock(locks_[node & (HNSW_LOCK_STRIPES - 1)]);
+            int32_t* block = links(node, l);
+            block[0] = neighbors.size();
+            for (size_t i = 0; i < neighbors.size(); i++) {
+                block[1 + i] = neighbors[i].second;
+            }
+        }
+        for (auto& neighbor : neighbors) {
+            connect(neighbor.second, node, l);
+        }
+    }
+
+    if (level > maxLevel) {
+        entry_ = node;
+        maxLevel_ = level;
+    }
+}
+
+void HnswIndex::connect(int32_t node, int32_t neighbor, int32_t level) {
+    std::lock_guard<std::mutex> lock(locks_[node & (HNSW_LOCK_STRIPES - 1)]);
+    int32_t* block = links(node, level);
+    const int32_t capacity = maxLinks(level);
+    if (block[0] < capacity) {
+        block[1 + block[0]] = neighbor;
+        block[0]++;
+        return;
+    }
+
+    // full: keep the most diverse links among the old ones and the new one
+    const real* base = row(node);
+    std::vector<Candidate> candidates;
+    candidates.reserve(capacity + 1);
+    candidates.push_back(Candidate(similarity(base, neighbor), neighbor));
+    for (int32_t i = 0; i < block[0]; i++) {
+        candidates.push_back(Candidate(similarity(base, block[1 + i]), block[1 + i]));
+    }
+    std::sort(candidates.begin(), candidates.end(), better);
+    std::vector<Candidate> kept = selectNeighbors(candidates, capacity);
+    block[0] = kept.size();
+    for (size_t i = 0; i < kept.size(); i++) {
+        block[1 + i] = kept[i].second;
+    }
+}
+
+void HnswIndex::greedyClosest(const real* query, int32_t& node, real& best,
+        int32_t from, int32_t to) const {
+    std::vector<int32_t> neighbors;
+    for (int32_t level = from; level > to; level--) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            copyLinks(node, level, neighbors);
+            for (int32_t neighbor : neighbors) {
+                real s = similarity(query, neighbor);
+                if (s > best) {
+                    best = s;
+                    node = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::searchLayer(const real* query,
+        const Candidate& entry, int32_t ef, int32_t level) const {
+    visited.reset(n_);
+    visited.visit(entry.second);
+
+    // candidates: max-heap of nodes to expand, top: min-heap of the ef best
+    std::vector<Candidate> candidates(1, entry);
+    std::vector<Candidate> top(1, entry);
+    std::vector<int32_t> neighbors;
+    while (!candidates.empty()) {
+        std::pop_heap(candidates.begin(), candidates.end(), worse);
+        Candidate current = candidates.back();
+        candidates.pop_back();
+        if (top.size() >= (size_t) ef && current.first < top.front().first) {
+            break;
+        }
+        copyLinks(current.second, level, neighbors);
+        for (int32_t neighbor : neighbors) {
+            if (!visited.visit(neighbor)) {
+                continue;
+            }
+            real s = similarity(query, neighbor);
+            if (top.size() < (size_t) ef || s > top.front().first) {
+                candidates.push_back(Candidate(s, neighbor));
+                std::push_heap(candidates.begin(), candidates.end(), worse);
+                top.push_back(Candidate(s, neighbor));
+                std::push_heap(top.begin(), top.end(), better);
+                if (top.size() > (size_t) ef) {
+                    std::pop_heap(top.begin(), top.end(), better);
+                    top.pop_back();
+                }
+            }
+        }
+    }
+    std::sort(top.begin(), top.end(), better);
+    return top;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::selectNeighbors(
+        std::vector<Candidate>& candidates, int32_t maxLinks) const {
+    if (candidates.size() <= (size_t) maxLinks) {
+        return candidates;
+    }
+    // a candidate is skipped when it is closer to an already selected
+    // neighbour than to the base node: that neighbour already leads to it
+    std::vector<Candidate> selected;
+    for (auto& candidate : candidates) {
+        if (selected.size() >= (size_t) maxLinks) {
+            break;
+        }
+        const real* vec = row(candidate.second);
+        bool keep = true;
+        for (auto& other : selected) {
+            if (similarity(vec, other.second) > candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate);
+        }
+    }
+    return selected;
+}
+
+std::vector<std::pair<real, int32_t>> HnswIndex::search(const Vector& query,
+        int32_t k, int32_t efSearch, const std::set<int32_t>& banSet) const {
+    std::vector<Candidate> found;
+    if (n_ == 0 || k <= 0) {
+        return found;
+    }
+    if (query.size() != dim_) {
+        throw std::invalid_argument("Query vector does not match the index dimension");
+    }
+    int32_t ef = std::max<int32_t>(efSearch, k + banSet.size());
+    Candidate best(similarity(query.data_, entry_), entry_);
+    greedyClosest(query.data_, best.second, best.first, maxLevel_, 0);
+    found = searchLayer(query.data_, best, ef, 0);
+
+    found.erase(std::remove_if(found.begin(), found.end(),
+        [&](const Candidate& c) { return banSet.count(c.second) > 0; }),
+        found.end());
+    if (found.size() > (size_t) k) {
+        found.resize(k);
+    }
+    return found;
+}
+
+void HnswIndex::save(const std::string& modelFilename) const {
+    int64_t modelSize;
+    int64_t modelMtime;
+    stampModel(modelFilename, modelSize, modelMtime);
+
+    // readers must never see a half written file
+    std::string filename = sidecarPath(modelFilename);
+    std::string tmpFilename = filename + ".tmp";
+    std::ofstream out(tmpFilename, std::ofstream::binary);
+    if (!out.is_open()) {
+        throw "Index file cannot be opened for saving!";
+    }
+    const int32_t magic = HNSW_MAGIC_INT32;
+    const int32_t version = HNSW_VERSION;
+    out.write((char*) &magic, sizeof(int32_t));
+    out.write((char*) &version, sizeof(int32_t));
+    out.write((char*) &modelSize, sizeof(int64_t));
+    out.write((char*) &modelMtime, sizeof(int64_t));
+    out.write((char*) &n_, sizeof(int32_t));
+    out.write((char*) &dim_, sizeof(int32_t));
+    out.write((char*) &M_, sizeof(int32_t));
+    out.write((char*) &maxLevel_, sizeof(int32_t));
+    out.write((char*) &entry_, sizeof(int32_t));
+    out.write((char*) &upperSize_, sizeof(int64_t));
+
+    fasttext::utils::pad(out, fasttext::MAPPED_ARRAY_ALIGNMENT);
+    out.write((char*) levels_, n_ * sizeof(int32_t));
+    fasttext::utils::pad(out, fasttext::MAPPED_ARRAY_ALIGNMENT);
+    out.write((char*) upperOffsets_, n_ * sizeof(int64_t));
+    fasttext::utils::pad(out, fasttext::MAPPED_PAGE_SIZE);
+    out.write((char*) links0_, (int64_t) n_ * (1 + maxLinks(0)) * sizeof(int32_t));
+    fasttext::utils::pad(out, fasttext::MAPPED_ARRAY_ALIGNMENT);
+    out.write((char*) upper_, upperSize_ * sizeof(int32_t));
+    out.close();
+    if (out.fail()) {
+        remove(tmpFilename.c_str());
+        throw "Index file cannot be written!";
+    }
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        remove(tmpFilename.c_str());
+        throw "Index file cannot be written!";
+    }
+}
+
+std::shared_ptr<HnswIndex> HnswIndex::load(const std::string& modelFilename,
+        std::shared_ptr<const Matrix> vectors) {
+    std::string filename = sidecarPath(modelFilename);
+    if (!std::ifstream(filename).good()) {
+        return nullptr;
+    }
+    int64_t modelSize;
+    int64_t modelMtime;
+    stampModel(modelFilename, modelSize, modelMtime);
+
+    std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(filename);
+    MappedStream in(file);
+
+    int32_t magic = 0;
+    int32_t version = 0;
+    int64_t size = 0;
+    int64_t mtime = 0;
+    in.read((char*) &magic, sizeof(int32_t));
+    in.read((char*) &version, sizeof(int32_t));
+    in.read((char*) &size, sizeof(int64_t));
+    in.read((char*) &mtime, sizeof(int64_t));
+    if (!in.good() || magic != HNSW_MAGIC_INT32 || version != HNSW_VERSION ||
+            size != modelSize || mtime != modelMtime) {
+        return nullptr;
+    }
+
+    int32_t n;
+    int32_t dim;
+    int32_t M;
+    in.read((char*) &n, sizeof(int32_t));
+    in.read((char*) &dim, sizeof(int32_t));
+    in.read((char*) &M, sizeof(int32_t));
+    if (!in.good() || n != vectors->m_ || dim != vectors->n_ || M < 2) {
+        return nullptr;
+    }
+
+    std::shared_ptr<HnswIndex> index(new HnswIndex(vectors, M));
+    in.read((char*) &index->maxLevel_, sizeof(int32_t));
+    in.read((char*) &index->entry_, sizeof(int32_t));
+    in.read((char*) &index->upperSize_, sizeof(int64_t));
+    if (!in.good()) {
+        throw std::invalid_argument("Index file is truncated!");
+    }
+    if (index->upperSize_ < 0 ||
+            index->upperSize_ > file->size() / (int64_t) sizeof(int32_t)) {
+        throw std::invalid_argument("Index file is corrupt!");
+    }
+    index->levels_ = in.view<int32_t>(n);
+    index->upperOffsets_ = in.view<int64_t>(n);
+    // mapped read-only: the index is never modified after a load
+    index->links0_ = const_cast<int32_t*>(in.view<int32_t>(
+        (int64_t) n * (1 + index->maxLinks(0)), fasttext::MAPPED_PAGE_SIZE));
+    index->upper_ = const_cast<int32_t*>(in.view<int32_t>(index->upperSize_));
+    index->mapping_ = file;
+    index->check();
+    return index;
+}
+
+void HnswIndex::check() const {
+    const int64_t upperBlock = 1 + M_;
+    bool ok = n_ > 0 && maxLevel_ >= 0 && maxLevel_ <= HNSW_MAX_LEVEL &&
+        entry_ >= 0 && entry_ < n_ && levels_[entry_] == maxLevel_;
+    for (int32_t node = 0; ok && node < n_; node++) {
+        const int32_t level = levels_[node];
+        const int64_t offset = upperOffsets_[node];
+        ok = level >= 0 && level <= maxLevel_ &&
+            (level == 0 || (offset >= 0 && offset <= upperSize_ &&
+                level * upperBlock <= upperSize_ - offset));
+        // a link on a level leads to a node that has a block on that level
+        for (int32_t l = 0; ok && l <= level; l++) {
+            const int32_t* block = links(node, l);
+            ok = block[0] >= 0 && block[0] <= maxLinks(l);
+            for (int32_t i = 1; ok && i <= block[0]; i++) {
+                ok = block[i] >= 0 && block[i] < n_ && levels_[block[i]] >= l;
+            }
+        }
+    }
+    if (!ok) {
+        throw std::invalid_argument("Index file is corrupt!");
+    }
+}
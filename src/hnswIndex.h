@@ -0,0 +1,112 @@
+
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../lib/src/fasttext.h"
+
+constexpr int32_t HNSW_MAGIC_INT32 = 793712316;
+constexpr int32_t HNSW_VERSION = 2;
+
+constexpr int32_t HNSW_DEFAULT_M = 16;
+constexpr int32_t HNSW_DEFAULT_EF_CONSTRUCTION = 200;
+constexpr int32_t HNSW_DEFAULT_EF_SEARCH = 64;
+
+// size and modification time of a model file, the mtime in nanoseconds
+// where the platform has them; what tells one version of it from another
+void stampModel(const std::string& modelFilename, int64_t& size, int64_t& mtime);
+
+/**
+ * Hierarchical navigable small world graph over the normalized word vectors.
+ *
+ * Every word is a node. Level 0 links each node to up to 2*M neighbours, the
+ * sparser upper levels to up to M. Links are kept in flat fixed size blocks
+ * of [count, id...], so a saved index is mapped back without any parsing.
+ * The vectors themselves are not stored, they come from the model.
+ */
+class HnswIndex {
+    public:
+        HnswIndex(const HnswIndex&) = delete;
+        HnswIndex& operator=(const HnswIndex&) = delete;
+
+        // inserts all rows of `vectors`, `threads` at a time
+        static std::shared_ptr<HnswIndex> build(
+                    std::shared_ptr<const fasttext::Matrix> vectors,
+                    int32_t M, int32_t efConstruction, int32_t threads);
+
+        // sidecar index of a model file, next to it
+        static std::string sidecarPath(const std::string& modelFilename);
+
+        // maps the sidecar of a model, empty when it is missing or was built
+        // for another version of the model file, as told by the size and
+        // modification time the sidecar records for it
+        static std::shared_ptr<HnswIndex> load(
+                    const std::string& modelFilename,
+                    std::shared_ptr<const fasttext::Matrix> vectors);
+        void save(const std::string& modelFilename) const;
+
+        // k best (similarity, word id) pairs for the query, best first
+        std::vector<std::pair<fasttext::real, int32_t>> search(
+                    const fasttext::Vector& query, int32_t k, int32_t efSearch,
+                    const std::set<int32_t>& banSet) const;
+
+        int32_t M() const { return M_; }
+
+    private:
+        typedef std::pair<fasttext::real, int32_t> Candidate;
+
+        HnswIndex(std::shared_ptr<const fasttext::Matrix>, int32_t M);
+
+        void allocate(int32_t efConstruction);
+        void insert(int32_t node, int32_t efConstruction);
+        void greedyClosest(const fasttext::real*, int32_t& node,
+                    fasttext::real& similarity, int32_t from, int32_t to) const;
+        std::vector<Candidate> searchLayer(const fasttext::real*,
+                    const Candidate& entry, int32_t ef, int32_t level) const;
+        std::vector<Candidate> selectNeighbors(std::vector<Candidate>&,
+                    int32_t maxLinks) const;
+        void connect(int32_t node, int32_t neighbor, int32_t level);
+        // throws unless every offset and link of a loaded graph is in range
+        void check() const;
+
+        fasttext::real similarity(const fasttext::real*, int32_t) const;
+        const fasttext::real* row(int32_t i) const;
+
+        int32_t maxLinks(int32_t level) const { return level == 0 ? 2 * M_ : M_; }
+        const int32_t* links(int32_t node, int32_t level) const;
+        int32_t* links(int32_t node, int32_t level);
+        void copyLinks(int32_t node, int32_t level, std::vector<int32_t>&) const;
+
+        std::shared_ptr<const fasttext::Matrix> vectors_;
+        int32_t n_;
+        int32_t dim_;
+        int32_t M_;
+        int32_t maxLevel_;
+        int32_t entry_;
+
+        // point into owned_ after a build, into mapping_ after a load
+        const int32_t* levels_;
+        const int64_t* upperOffsets_;
+        int32_t* links0_;
+        int32_t* upper_;
+        int64_t upperSize_;
+
+        std::vector<int32_t> ownedLevels_;
+        std::vector<int64_t> ownedUpperOffsets_;
+        std::vector<int32_t> ownedLinks0_;
+        std::vector<int32_t> ownedUpper_;
+        std::shared_ptr<const fasttext::MappedFile> mapping_;
+
+        // only during a build: striped locks over the link blocks
+        std::unique_ptr<std::mutex[]> locks_;
+        std::mutex entryMtx_;
+};
+
+#endif
@@ -0,0 +1,29 @@
+
+#include "inferenceScratch.h"
+
+#include <algorithm>
+
+using fasttext::Vector;
+
+// sizes kept per slot, e.g. models of different dimensions on one thread
+constexpr size_t SCRATCH_SIZES_PER_SLOT = 4;
+
+InferenceScratch& InferenceScratch::local() {
+    static thread_local InferenceScratch scratch;
+    return scratch;
+}
+
+Vector& InferenceScratch::vector(Slot slot, int64_t size) {
+    std::vector<std::unique_ptr<Vector>>& vectors = vectors_[slot];
+    for (size_t i = 0; i < vectors.size(); i++) {
+        if (vectors[i]->size() == size) {
+            std::rotate(vectors.begin(), vectors.begin() + i, vectors.begin() + i + 1);
+            return *vectors[0];
+        }
+    }
+    if (vectors.size() == SCRATCH_SIZES_PER_SLOT) {
+        vectors.pop_back();
+    }
+    vectors.emplace(vectors.begin(), new Vector(size));
+    return *vectors[0];
+}
@@ -0,0 +1,50 @@
+
+#ifndef INFERENCE_SCRATCH_H
+#define INFERENCE_SCRATCH_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../lib/src/fasttext.h"
+
+/**
+ * Buffers of one thread for the prediction or sentence vector it computes.
+ *
+ * Every thread gets its own instance on first use and keeps it: the id
+ * buffers only grow, and the vectors are kept for the last few sizes asked
+ * for, so a thread serving the same models again does not allocate at all.
+ * A caller must be done with a buffer before calling anything that may use
+ * the same one.
+ */
+class InferenceScratch {
+    public:
+        enum Slot {
+            HIDDEN = 0,
+            OUTPUT,
+            WORD,
+            SLOTS
+        };
+
+        // the scratch of the calling thread
+        static InferenceScratch& local();
+
+        // a vector of exactly `size` values, contents undefined
+        fasttext::Vector& vector(Slot, int64_t size);
+
+        std::vector<int32_t> words;
+        std::vector<int32_t> labels;
+        std::vector<int32_t> ngrams;
+        std::vector<std::pair<fasttext::real, int32_t>> heap;
+
+    private:
+        InferenceScratch() = default;
+        InferenceScratch(const InferenceScratch&) = delete;
+        InferenceScratch& operator=(const InferenceScratch&) = delete;
+
+        // most recently used first
+        std::vector<std::unique_ptr<fasttext::Vector>> vectors_[SLOTS];
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "loadWorker.h"
+#include <v8.h>
+
+void LoadWorker::Execute () {
+    try {
+        if (warmUp_) {
+            wrapper_->warmUp(predictions_);
+        } else {
+            wrapper_->loadModel(predictions_);
+        }
+    } catch (std::string errorMessage) {
+        SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        SetErrorMessage(str);
+    } catch(const std::exception& e) {
+        SetErrorMessage(e.what());
+    }
+}
+
+void LoadWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage())
+    };
+
+    callback->Call(1, argv);
+}
+
+void LoadWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    if (publish_ && !publish_(wrapper_)) {
+        v8::Local<v8::Value> argv[] = {
+            Nan::Error("Superseded by a later reload or train!")
+        };
+        callback->Call(1, argv);
+        return;
+    }
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null()
+    };
+
+    callback->Call(1, argv);
+}
@@ -0,0 +1,42 @@
+#ifndef LOAD_WORKER_H
+#define LOAD_WORKER_H
+
+#include <nan.h>
+
+#include <functional>
+
+#include "wrapper.h"
+
+/**
+ * Loads, and optionally warms up, a wrapper off the main thread. The publish
+ * function then runs on the main thread before the callback, which is how
+ * reload() swaps the new model in only once it is ready. When it declines,
+ * the callback gets an error.
+ */
+class LoadWorker : public Nan::AsyncWorker {
+    public:
+        // false when the wrapper was not swapped in
+        typedef std::function<bool(std::shared_ptr<Wrapper>)> Publish;
+
+        LoadWorker (Nan::Callback *callback, std::shared_ptr<Wrapper> wrapper,
+                bool predictions, bool warmUp, Publish publish)
+            : Nan::AsyncWorker(callback),
+                wrapper_(wrapper),
+                publish_(publish),
+                predictions_(predictions),
+                warmUp_(warmUp) {};
+
+        ~LoadWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        std::shared_ptr<Wrapper> wrapper_;
+        Publish publish_;
+        bool predictions_;
+        bool warmUp_;
+};
+
+#endif
@@ -0,0 +1,38 @@
+
+#include "mapModelWorker.h"
+#include "mappedModel.h"
+#include <v8.h>
+
+void MapModelWorker::Execute () {
+    try {
+        std::shared_ptr<SharedModel> model = ModelRegistry::acquire(source_);
+        MappedModel::save(*model, target_);
+    } catch (std::string errorMessage) {
+        this->SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        this->SetErrorMessage(str);
+    } catch (const std::exception& e) {
+        this->SetErrorMessage(e.what());
+    }
+}
+
+
+void MapModelWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage())
+    };
+
+    callback->Call(1, argv);
+}
+
+void MapModelWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null()
+    };
+
+    callback->Call(1, argv);
+}
@@ -0,0 +1,25 @@
+#ifndef MAP_MODEL_WORKER_H
+#define MAP_MODEL_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class MapModelWorker : public Nan::AsyncWorker {
+    public:
+        MapModelWorker (Nan::Callback *callback, std::string source, std::string target)
+            : Nan::AsyncWorker(callback),
+                source_(source),
+                target_(target) {};
+
+        ~MapModelWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        std::string source_;
+        std::string target_;
+};
+
+#endif
@@ -0,0 +1,113 @@
+
+#include "mappedModel.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <vector>
+
+using fasttext::Args;
+using fasttext::Dictionary;
+using fasttext::Matrix;
+using fasttext::QMatrix;
+using fasttext::MappedFile;
+using fasttext::MappedStream;
+
+bool MappedModel::isMapped(const std::string& filename) {
+    std::ifstream in(filename, std::ifstream::binary);
+    int32_t magic = 0;
+    in.read((char*)&(magic), sizeof(int32_t));
+    return in.good() && magic == FASTTEXT_MAPPED_MAGIC_INT32;
+}
+
+void MappedModel::save(const SharedModel& m, const std::string& filename) {
+    // readers must never see a half written file
+    std::string tmpFilename = filename + ".tmp";
+    std::vector<char> buffer(MODEL_WRITE_BUFFER_SIZE);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    out.open(tmpFilename, std::ofstream::binary);
+    if (!out.is_open()) {
+        throw "Mapped model file cannot be opened for saving!";
+    }
+    const int32_t magic = FASTTEXT_MAPPED_MAGIC_INT32;
+    const int32_t version = FASTTEXT_VERSION;
+    const int32_t mappedVersion = FASTTEXT_MAPPED_VERSION;
+    out.write((char*)&(magic), sizeof(int32_t));
+    out.write((char*)&(version), sizeof(int32_t));
+    out.write((char*)&(mappedVersion), sizeof(int32_t));
+
+    m.args->save(out);
+    m.dict->saveMapped(out);
+
+    out.write((char*)&(m.quant), sizeof(bool));
+    if (m.quant) {
+        m.qinput->saveMapped(out);
+    } else {
+        m.input->saveMapped(out);
+    }
+
+    out.write((char*)&(m.args->qout), sizeof(bool));
+    if (m.quant && m.args->qout) {
+        m.qoutput->saveMapped(out);
+    } else {
+        m.output->saveMapped(out);
+    }
+    out.close();
+    if (out.fail()) {
+        remove(tmpFilename.c_str());
+        throw "Mapped model file cannot be written!";
+    }
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        remove(tmpFilename.c_str());
+        throw "Mapped model file cannot be written!";
+    }
+}
+
+std::shared_ptr<SharedModel> MappedModel::load(const std::string& filename) {
+    std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(filename);
+    MappedStream in(file);
+
+    int32_t magic;
+    int32_t version;
+    int32_t mappedVersion;
+    in.read((char*)&(magic), sizeof(int32_t));
+    in.read((char*)&(version), sizeof(int32_t));
+    in.read((char*)&(mappedVersion), sizeof(int32_t));
+    if (!in.good() || magic != FASTTEXT_MAPPED_MAGIC_INT32 ||
+            version != FASTTEXT_VERSION || mappedVersion != FASTTEXT_MAPPED_VERSION) {
+        throw "Model file has wrong file format!";
+    }
+
+    std::shared_ptr<SharedModel> m = std::make_shared<SharedModel>();
+    m->args = std::make_shared<Args>();
+    m->dict = std::make_shared<Dictionary>(m->args);
+    m->input = std::make_shared<Matrix>();
+    m->output = std::make_shared<Matrix>();
+    m->qinput = std::make_shared<QMatrix>();
+    m->qoutput = std::make_shared<QMatrix>();
+    m->quant = false;
+    m->hasOutput = true;
+    m->args->load(in);
+
+    m->dict->loadMapped(in);
+
+    bool quant_input;
+    in.read((char*) &quant_input, sizeof(bool));
+    if (quant_input) {
+        m->quant = true;
+        m->qinput->loadMapped(in);
+    } else {
+        m->input->loadMapped(in);
+    }
+
+    in.read((char*) &m->args->qout, sizeof(bool));
+    if (m->quant && m->args->qout) {
+        m->qoutput->loadMapped(in);
+    } else {
+        m->output->loadMapped(in);
+    }
+
+    m->initModel();
+    return m;
+}
@@ -0,0 +1,31 @@
+
+#ifndef MAPPED_MODEL_H
+#define MAPPED_MODEL_H
+
+#include <memory>
+#include <string>
+
+#include "modelRegistry.h"
+
+constexpr int32_t FASTTEXT_MAPPED_MAGIC_INT32 = 793712315;
+constexpr int32_t FASTTEXT_MAPPED_VERSION = 1;
+
+/**
+ * Page aligned variant of the .bin format.
+ *
+ * Matrices and quantized codes start on page boundaries, so loading only maps
+ * the file and points the matrices into it: nothing is copied, and processes
+ * serving the same file share its pages. The dictionary is stored as flat
+ * arrays together with its hash table and subwords, so loading it does not
+ * hash or tokenize anything.
+ */
+class MappedModel {
+    public:
+        // true when the file starts with the mapped format signature
+        static bool isMapped(const std::string& filename);
+
+        static std::shared_ptr<SharedModel> load(const std::string& filename);
+        static void save(const SharedModel&, const std::string& filename);
+};
+
+#endif
@@ -0,0 +1,306 @@
+// modelObject.h
+#ifndef MODEL_OBJECT_H
+#define MODEL_OBJECT_H
+
+#include <nan.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nodeArgument.h"
+#include "wrapper.h"
+#include "workerPool.h"
+#include "trainWorker.h"
+#include "saveModelWorker.h"
+#include "loadWorker.h"
+#include "resultCache.h"
+
+/**
+ * What Classifier and Query share: the model they serve, the methods that
+ * load, reload, train and save it, and the parsing of their options.
+ *
+ * reload() and train() build a new wrapper and swap it in on the main
+ * thread once it is ready. When several overlap, the one started last wins:
+ * an older one completing after it is dropped, and its callback gets an
+ * error.
+ */
+class ModelObject : public Nan::ObjectWrap {
+    protected:
+        // predictions false loads only what nn and vectors need
+        ModelObject(std::string modelFilename, bool predictions) :
+            wrapper_(std::make_shared<Wrapper>(modelFilename)),
+            predictions_(predictions),
+            swapsStarted_(0),
+            swapPublished_(0)
+            {}
+
+        // load([{ warmUp, subwordTable }], callback) loads the model now
+        // instead of on the first request; warmUp (default true) also builds
+        // its caches, subwordTable (default false) the subword sums
+        static NAN_METHOD(Load) {
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+
+            int callbackIndex = 0;
+            bool warmUp = true;
+            bool subwordTable = obj->wrapper_->usesSubwordTable();
+            if (info[0]->IsObject() && !info[0]->IsFunction()) {
+                warmUp = BoolOption(info[0].As<v8::Object>(), "warmUp", warmUp);
+                subwordTable = BoolOption(info[0].As<v8::Object>(),
+                    "subwordTable", subwordTable);
+                callbackIndex = 1;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            obj->wrapper_->setSubwordTable(subwordTable);
+            LoadWorker* worker = new LoadWorker(callback, obj->wrapper_,
+                obj->predictions_, warmUp, LoadWorker::Publish());
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        // reload(path, [{ warmUp, subwordTable }], callback) loads another
+        // model file, or a new version of the same one, and swaps it in once
+        // it is ready
+        static NAN_METHOD(Reload) {
+            if (!info[0]->IsString()) {
+                Nan::ThrowError("path must be a string");
+                return;
+            }
+
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+
+            int callbackIndex = 1;
+            bool warmUp = true;
+            bool subwordTable = obj->wrapper_->usesSubwordTable();
+            if (info[1]->IsObject() && !info[1]->IsFunction()) {
+                warmUp = BoolOption(info[1].As<v8::Object>(), "warmUp", warmUp);
+                subwordTable = BoolOption(info[1].As<v8::Object>(),
+                    "subwordTable", subwordTable);
+                callbackIndex = 2;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            Nan::Utf8String pathArg(info[0]);
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            std::shared_ptr<Wrapper> next =
+                std::make_shared<Wrapper>(std::string(*pathArg));
+            next->setSubwordTable(subwordTable);
+            LoadWorker* worker = new LoadWorker(callback, next,
+                obj->predictions_, warmUp, obj->startSwap());
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        // the options of train(options, [onProgress], callback) as CLI
+        // arguments, without the model one, which goes to model; false
+        // after throwing to JS
+        static bool TrainArguments(const Nan::FunctionCallbackInfo<v8::Value>& info,
+                std::vector<std::string>& args, std::string& model) {
+            if (!info[0]->IsObject()) {
+                Nan::ThrowError("options argument must be an object.");
+                return false;
+            }
+
+            int callbackIndex = info[1]->IsFunction() && info[2]->IsFunction() ? 2 : 1;
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return false;
+            }
+
+            v8::Local<v8::Object> confObj = v8::Local<v8::Object>::Cast( info[0] );
+
+            NodeArgument::NodeArgument nodeArg;
+            NodeArgument::CArgument c_argument;
+
+            try {
+                c_argument = nodeArg.ObjectToCArgument( confObj );
+            } catch (std::string errorMessage) {
+                Nan::ThrowError(errorMessage.c_str());
+                return false;
+            }
+
+            int count = c_argument.argc;
+            char** argument = c_argument.argv;
+
+            for(int j = 0; j < count; j++) {
+                if (std::string(argument[j]) == "-model" && j + 1 < count) {
+                    model = argument[++j];
+                    continue;
+                }
+                args.push_back(argument[j]);
+            }
+            return true;
+        }
+
+        // trains a model of its own with the command and args of
+        // TrainArguments, swapped in on the main thread
+        static void QueueTrain(const Nan::FunctionCallbackInfo<v8::Value>& info,
+                const std::string& command, std::vector<std::string> args) {
+            int callbackIndex = 1;
+            Nan::Callback *onProgress = NULL;
+            if (info[1]->IsFunction() && info[2]->IsFunction()) {
+                onProgress = new Nan::Callback(info[1].As<v8::Function>());
+                callbackIndex = 2;
+            }
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+
+            args.insert(args.begin(), { "-command", command });
+            std::shared_ptr<Wrapper> next =
+                std::make_shared<Wrapper>(obj->wrapper_->getModelFilename());
+            next->setSubwordTable(obj->wrapper_->usesSubwordTable());
+            TrainWorker* worker = new TrainWorker(callback, onProgress, args,
+                next, obj->startSwap());
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        // saveModel(filename, [{ mapped }], callback) writes the current
+        // model, as a .bin file or page aligned as mapModel does
+        static NAN_METHOD(SaveModel) {
+            if (!info[0]->IsString()) {
+                Nan::ThrowError("filename must be a string");
+                return;
+            }
+
+            int callbackIndex = 1;
+            bool mapped = false;
+            if (info[1]->IsObject() && !info[1]->IsFunction()) {
+                mapped = BoolOption(info[1].As<v8::Object>(), "mapped", mapped);
+                callbackIndex = 2;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            Nan::Utf8String filenameArg(info[0]);
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+
+            SaveModelWorker* worker = new SaveModelWorker(callback,
+                std::string(*filenameArg), mapped, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        // setCache({ maxBytes }) keeps the results of repeated texts, up to
+        // maxBytes of them; 0 turns the cache off
+        static NAN_METHOD(SetCache) {
+            if (!info[0]->IsObject()) {
+                Nan::ThrowError("options argument must be an object.");
+                return;
+            }
+            v8::Local<v8::Value> maxBytes = Nan::Get(info[0].As<v8::Object>(),
+                Nan::New("maxBytes").ToLocalChecked()).ToLocalChecked();
+            if (!maxBytes->IsNumber() || Nan::To<double>(maxBytes).FromJust() < 0) {
+                Nan::ThrowError("maxBytes must be a positive number");
+                return;
+            }
+
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+            obj->wrapper_->setCache(Nan::To<int64_t>(maxBytes).FromJust());
+        }
+
+        // cacheStats() returns { hits, misses, hitRate, entries, bytes }
+        static NAN_METHOD(GetCacheStats) {
+            ModelObject* obj = Nan::ObjectWrap::Unwrap<ModelObject>(info.Holder());
+            CacheStats stats = obj->wrapper_->cacheStats();
+            int64_t requests = stats.hits + stats.misses;
+
+            v8::Local<v8::Object> result = Nan::New<v8::Object>();
+            Nan::Set(result, Nan::New("hits").ToLocalChecked(),
+                Nan::New<v8::Number>(stats.hits));
+            Nan::Set(result, Nan::New("misses").ToLocalChecked(),
+                Nan::New<v8::Number>(stats.misses));
+            Nan::Set(result, Nan::New("hitRate").ToLocalChecked(),
+                Nan::New<v8::Number>(requests > 0 ? (double) stats.hits / requests : 0.0));
+            Nan::Set(result, Nan::New("entries").ToLocalChecked(),
+                Nan::New<v8::Number>(stats.entries));
+            Nan::Set(result, Nan::New("bytes").ToLocalChecked(),
+                Nan::New<v8::Number>(stats.bytes));
+            info.GetReturnValue().Set(result);
+        }
+
+        // options.name when it is set, fallback otherwise
+        static int32_t IntOption(v8::Local<v8::Object> options, const char* name,
+                int32_t fallback) {
+            v8::Local<v8::Value> value =
+                Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+            if (value->IsUndefined()) {
+                return fallback;
+            }
+            if (!value->IsUint32()) {
+                throw std::string(name) + " must be a number";
+            }
+            return Nan::To<int32_t>(value).FromJust();
+        }
+
+        static double NumberOption(v8::Local<v8::Object> options, const char* name,
+                double fallback) {
+            v8::Local<v8::Value> value =
+                Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+            if (value->IsUndefined()) {
+                return fallback;
+            }
+            if (!value->IsNumber()) {
+                throw std::string(name) + " must be a number";
+            }
+            return Nan::To<double>(value).FromJust();
+        }
+
+        static bool BoolOption(v8::Local<v8::Object> options, const char* name,
+                bool fallback) {
+            v8::Local<v8::Value> value =
+                Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+            if (value->IsUndefined()) {
+                return fallback;
+            }
+            return Nan::To<bool>(value).FromJust();
+        }
+
+        // replaced as a whole by reload() and train(): workers hold their
+        // own reference, so requests in flight finish on the model they
+        // started with
+        std::shared_ptr<Wrapper> wrapper_;
+
+    private:
+        // numbers a new swap. Its publish function runs on the main thread,
+        // where every request takes its reference to the wrapper, so none of
+        // them ever waits for it. It returns false, without swapping, when a
+        // swap started later was published first.
+        std::function<bool(std::shared_ptr<Wrapper>)> startSwap() {
+            const uint64_t swap = ++swapsStarted_;
+            return [this, swap](std::shared_ptr<Wrapper> wrapper) {
+                if (swap < swapPublished_) {
+                    return false;
+                }
+                swapPublished_ = swap;
+                wrapper->copySettings(*wrapper_);
+                wrapper_ = wrapper;
+                return true;
+            };
+        }
+
+        const bool predictions_;
+        // only read and written on the main thread
+        uint64_t swapsStarted_;
+        uint64_t swapPublished_;
+};
+
+#endif
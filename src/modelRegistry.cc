@@ -0,0 +1,191 @@
+
+#include "modelRegistry.h"
+#include "mappedModel.h"
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <tuple>
+
+#ifdef WIN
+#define stat _stat64
+#endif
+
+using fasttext::Args;
+using fasttext::Dictionary;
+using fasttext::Matrix;
+using fasttext::QMatrix;
+using fasttext::Model;
+using fasttext::model_name;
+using fasttext::entry_type;
+
+std::mutex ModelRegistry::mtx_;
+std::map<ModelRegistry::Key, std::shared_ptr<ModelRegistry::Entry>> ModelRegistry::entries_;
+
+void SharedModel::initModel() {
+    // shared models only serve predictions and are never trained
+    model = std::make_shared<Model>(input, output, args, 0, true);
+    model->quant_ = quant;
+    model->setQuantizePointer(qinput, qoutput, args->qout);
+
+    if (args->model == model_name::sup) {
+        model->setTargetCounts(dict->getCounts(entry_type::label));
+    } else {
+        model->setTargetCounts(dict->getCounts(entry_type::word));
+    }
+    batcher = std::make_shared<PredictBatcher>(model);
+}
+
+void SharedModel::loadOutput() {
+    std::lock_guard<std::mutex> lock(outputMtx);
+    if (hasOutput) {
+        return;
+    }
+    if (quant && args->qout) {
+        qoutput->load(*source);
+    } else {
+        output->load(*source);
+    }
+    source.reset();
+    initModel();
+    hasOutput = true;
+}
+
+bool ModelRegistry::Key::operator<(const Key& other) const {
+    return std::tie(path, device, inode, size, mtime) <
+        std::tie(other.path, other.device, other.inode, other.size, other.mtime);
+}
+
+ModelRegistry::Key ModelRegistry::identify(const std::string& filename) {
+    Key key;
+#ifdef WIN
+    char* resolved = _fullpath(NULL, filename.c_str(), 0);
+#else
+    char* resolved = realpath(filename.c_str(), NULL);
+#endif
+    if (resolved == NULL) {
+        throw "Model file cannot be opened for loading!";
+    }
+    key.path = std::string(resolved);
+    free(resolved);
+
+    struct stat st;
+    if (stat(key.path.c_str(), &st) != 0) {
+        throw "Model file cannot be opened for loading!";
+    }
+    key.device = st.st_dev;
+    key.inode = st.st_ino;
+    stampModel(key.path, key.size, key.mtime);
+    return key;
+}
+
+std::shared_ptr<SharedModel> ModelRegistry::acquire(const std::string& filename,
+        bool withOutput) {
+    Key key = identify(filename);
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            // entries still referenced elsewhere may be in the middle of a load
+            if (it->second->model.expired() && it->second.use_count() == 1) {
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        std::shared_ptr<Entry>& slot = entries_[key];
+        if (!slot) {
+            slot = std::make_shared<Entry>();
+        }
+        entry = slot;
+    }
+
+    // loading happens under the entry lock only, so concurrent loads of
+    // different models do not wait for each other
+    std::shared_ptr<SharedModel> model;
+    {
+        std::lock_guard<std::mutex> lock(entry->mtx);
+        model = entry->model.lock();
+        if (!model) {
+            model = load(key.path, withOutput);
+            entry->model = model;
+        }
+    }
+    if (withOutput) {
+        model->loadOutput();
+    }
+    return model;
+}
+
+size_t ModelRegistry::size() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t alive = 0;
+    for (auto& it : entries_) {
+        if (!it.second->model.expired()) {
+            alive++;
+        }
+    }
+    return alive;
+}
+
+bool ModelRegistry::checkModel(std::istream& in) {
+    int32_t magic;
+    int32_t version;
+    in.read((char*)&(magic), sizeof(int32_t));
+    if (magic != FASTTEXT_FILEFORMAT_MAGIC_INT32) {
+        return false;
+    }
+    in.read((char*)&(version), sizeof(int32_t));
+    if (version != FASTTEXT_VERSION) {
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<SharedModel> ModelRegistry::load(const std::string& filename,
+        bool withOutput) {
+    if (MappedModel::isMapped(filename)) {
+        // mapping the output costs nothing until it is read
+        return MappedModel::load(filename);
+    }
+    std::shared_ptr<std::ifstream> source =
+        std::make_shared<std::ifstream>(filename, std::ifstream::binary);
+    std::ifstream& in = *source;
+    if (!in.is_open()) {
+        throw "Model file cannot be opened for loading!";
+    }
+    if (!checkModel(in)) {
+        throw "Model file has wrong file format!";
+    }
+
+    std::shared_ptr<SharedModel> m = std::make_shared<SharedModel>();
+    m->args = std::make_shared<Args>();
+    m->dict = std::make_shared<Dictionary>(m->args);
+    m->input = std::make_shared<Matrix>();
+    m->output = std::make_shared<Matrix>();
+    m->qinput = std::make_shared<QMatrix>();
+    m->qoutput = std::make_shared<QMatrix>();
+    m->quant = false;
+    m->hasOutput = false;
+    m->args->load(in);
+
+    m->dict->load(in);
+
+    bool quant_input;
+    in.read((char*) &quant_input, sizeof(bool));
+    if (quant_input) {
+        m->quant = true;
+        m->qinput->load(in);
+    } else {
+        m->input->load(in);
+    }
+
+    in.read((char*) &m->args->qout, sizeof(bool));
+    m->source = source;
+    if (withOutput) {
+        m->loadOutput();
+    }
+    return m;
+}
@@ -0,0 +1,107 @@
+
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../lib/src/fasttext.h"
+#include "hnswIndex.h"
+#include "predictBatcher.h"
+#include "subwordTable.h"
+
+constexpr int32_t FASTTEXT_VERSION = 12; /* Version 1b */
+constexpr int32_t FASTTEXT_FILEFORMAT_MAGIC_INT32 = 793712314;
+// saving a dictionary is one small write per field of every entry
+constexpr size_t MODEL_WRITE_BUFFER_SIZE = 1 << 20;
+
+/**
+ * One loaded .bin model. It is never modified after loading, so every
+ * Wrapper created over the same file can hold the same instance.
+ */
+struct SharedModel {
+    std::shared_ptr<fasttext::Args> args;
+    std::shared_ptr<fasttext::Dictionary> dict;
+
+    std::shared_ptr<fasttext::Matrix> input;
+    std::shared_ptr<fasttext::Matrix> output;
+
+    std::shared_ptr<fasttext::QMatrix> qinput;
+    std::shared_ptr<fasttext::QMatrix> qoutput;
+
+    std::shared_ptr<fasttext::Model> model;
+    bool quant;
+    // fuses concurrent predictions of every Wrapper over this model
+    std::shared_ptr<PredictBatcher> batcher;
+
+    // builds the Model over the loaded matrices
+    void initModel();
+
+    // reads the output matrix skipped by an embeddings-only load, and
+    // builds the Model: only prediction needs either of them
+    void loadOutput();
+    bool hasOutput;
+    // kept open until the output is read, so that it still comes from the
+    // same file even if the model was replaced on disk in the meantime
+    std::shared_ptr<std::ifstream> source;
+    std::mutex outputMtx;
+
+    // normalized word vectors for nn queries, built on first use
+    std::shared_ptr<fasttext::Matrix> wordVectors;
+    std::mutex precomputeMtx;
+
+    // per-word subword sums of the input matrix, built on first use
+    std::shared_ptr<SubwordTable> subwords;
+    std::mutex subwordsMtx;
+
+    // approximate nn index over wordVectors, loaded or built on first use
+    std::shared_ptr<HnswIndex> index;
+    std::mutex indexMtx;
+};
+
+/**
+ * Process-wide cache of loaded models.
+ *
+ * Models are keyed by their canonical path and by the identity of the file
+ * (device, inode, size and mtime), so a file replaced on disk is loaded again.
+ * The registry keeps only weak references: a model is freed as soon as
+ * the last Wrapper holding it goes away.
+ */
+class ModelRegistry {
+    public:
+        // withOutput false skips the output matrix until some caller needs it
+        static std::shared_ptr<SharedModel> acquire(const std::string& filename,
+                    bool withOutput = true);
+
+        // number of models currently alive in the registry
+        static size_t size();
+
+    private:
+        struct Key {
+            std::string path;
+            uint64_t device;
+            uint64_t inode;
+            int64_t size;
+            int64_t mtime;
+
+            bool operator<(const Key&) const;
+        };
+
+        struct Entry {
+            std::mutex mtx;
+            std::weak_ptr<SharedModel> model;
+        };
+
+        static Key identify(const std::string& filename);
+        static std::shared_ptr<SharedModel> load(const std::string& filename,
+                    bool withOutput);
+        static bool checkModel(std::istream&);
+
+        static std::mutex mtx_;
+        static std::map<Key, std::shared_ptr<Entry>> entries_;
+};
+
+#endif
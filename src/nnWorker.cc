@@ -5,9 +5,13 @@
 
 void NnWorker::Execute () {
     try {
-        wrapper_->loadModel();
+        wrapper_->loadModel(false);
         wrapper_->precomputeWordVectors();
-        result_ = wrapper_->nn(query_, k_);
+        if (approximate_) {
+            result_ = wrapper_->approximateNn(query_, k_, efSearch_, threads_);
+        } else {
+            result_ = wrapper_->nn(query_, k_, threads_);
+        }
     } catch (std::string errorMessage) {
         SetErrorMessage(errorMessage.c_str());
     } catch (const char * str) {
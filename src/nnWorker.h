@@ -7,10 +7,14 @@
 
 class NnWorker : public Nan::AsyncWorker {
     public:
-        NnWorker (Nan::Callback *callback, std::string query, int32_t k, Wrapper *wrapper)
+        NnWorker (Nan::Callback *callback, std::string query, int32_t k, int32_t threads,
+                bool approximate, int32_t efSearch, std::shared_ptr<Wrapper> wrapper)
             : Nan::AsyncWorker(callback),
                 query_(query),
                 k_(k),
+                threads_(threads),
+                approximate_(approximate),
+                efSearch_(efSearch),
                 wrapper_(wrapper),
                 result_() {};
 
@@ -23,7 +27,10 @@ class NnWorker : public Nan::AsyncWorker {
     private:
         std::string query_;
         int32_t k_;
-        Wrapper *wrapper_;
+        int32_t threads_;
+        bool approximate_;
+        int32_t efSearch_;
+        std::shared_ptr<Wrapper> wrapper_;
         std::vector<PredictResult> result_;
 };
 
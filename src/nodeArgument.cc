@@ -113,8 +113,8 @@ namespace NodeArgument
         "input", "test", "output", "lr", "lrUpdateRate",
         "dim", "ws", "epoch", "minCount", "minCountLabel", "neg",
         "wordNgrams", "loss", "bucket", "minn", "maxn",
-        "thread", "t", "label", "verbose", "pretrainedVectors",
-        "cutoff", "dsub", "qnorm", "qout", "retrain"
+        "thread", "dictThreads", "cacheCorpus", "t", "label", "verbose", "pretrainedVectors",
+        "cutoff", "dsub", "qnorm", "qout", "retrain", "model"
       };
 
       for (uint32_t i = 0; i < indexLen; ++i) {
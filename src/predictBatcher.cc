@@ -0,0 +1,111 @@
+
+#include "predictBatcher.h"
+
+using fasttext::Model;
+using fasttext::Vector;
+using fasttext::real;
+
+PredictBatcher::PredictBatcher(std::shared_ptr<const Model> model)
+    : model_(model), arriving_(0) {}
+
+PredictBatcher::Arrival::Arrival(PredictBatcher& batcher, int32_t maxBatch,
+        std::chrono::microseconds window)
+    : batcher_(batcher), maxBatch_(maxBatch), window_(window), submitted_(false) {
+    std::lock_guard<std::mutex> lock(batcher_.mtx_);
+    batcher_.arriving_++;
+}
+
+PredictBatcher::Arrival::~Arrival() {
+    if (submitted_) {
+        return;
+    }
+    // e.g. a line without any known word: the open batch should not wait for it
+    std::lock_guard<std::mutex> lock(batcher_.mtx_);
+    batcher_.arriving_--;
+    if (batcher_.open_) {
+        batcher_.open_->cv.notify_all();
+    }
+}
+
+void PredictBatcher::Arrival::predict(int32_t k,
+        std::vector<std::pair<real, int32_t>>& heap, Vector& hidden,
+        Vector& output, real threshold) {
+    Request request = { k, threshold, &heap, &hidden, &output, false, nullptr };
+    submitted_ = true;
+    batcher_.submit(request, maxBatch_, window_);
+    if (request.error) {
+        std::rethrow_exception(request.error);
+    }
+}
+
+void PredictBatcher::submit(Request& request, int32_t maxBatch,
+        std::chrono::microseconds window) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    arriving_--;
+
+    if (open_) {
+        // join: the leader computes this request along with its own
+        std::shared_ptr<Batch> batch = open_;
+        batch->requests.push_back(&request);
+        if (batch->requests.size() >= batch->maxBatch) {
+            open_.reset();
+        }
+        batch->cv.notify_all();
+        batch->cv.wait(lock, [&request] { return request.done; });
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->maxBatch = maxBatch > 1 ? maxBatch : 1;
+    batch->requests.push_back(&request);
+    if (batch->maxBatch > 1) {
+        open_ = batch;
+        batch->cv.wait_for(lock, window, [this, &batch] {
+            return batch->requests.size() >= batch->maxBatch || arriving_ == 0;
+        });
+        if (open_ == batch) {
+            open_.reset();
+        }
+    }
+    std::vector<Request*> requests = batch->requests;
+    lock.unlock();
+
+    // the batch is closed, callers arriving now start the next one while
+    // this one is computed
+    compute(requests);
+
+    lock.lock();
+    for (Request* r : requests) {
+        r->done = true;
+    }
+    batch->cv.notify_all();
+}
+
+void PredictBatcher::compute(const std::vector<Request*>& requests) const {
+    std::vector<int32_t> k;
+    std::vector<real> threshold;
+    std::vector<std::vector<std::pair<real, int32_t>>*> heaps;
+    std::vector<Vector*> hidden, output;
+    for (Request* r : requests) {
+        k.push_back(r->k);
+        threshold.push_back(r->threshold);
+        heaps.push_back(r->heap);
+        hidden.push_back(r->hidden);
+        output.push_back(r->output);
+    }
+    try {
+        model_->predictBatch(k, threshold, heaps, hidden, output);
+        return;
+    } catch (...) {
+    }
+    // one of the requests failed: compute them again one by one so that
+    // only its own caller gets the error
+    for (Request* r : requests) {
+        try {
+            r->heap->clear();
+            model_->predict(r->k, *r->heap, *r->hidden, *r->output, r->threshold);
+        } catch (...) {
+            r->error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+
+#ifndef PREDICT_BATCHER_H
+#define PREDICT_BATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../lib/src/fasttext.h"
+
+/**
+ * Fuses predictions running at the same time on one model into a single
+ * pass over its output matrix.
+ *
+ * The first caller to submit opens a batch and leads it: it waits for the
+ * other callers to join, then computes every prediction of the batch with
+ * Model::predictBatch and wakes them up. The leader stops waiting as soon as
+ * the batch is full, the window is over, or no other caller is still on its
+ * way, so a caller alone never waits at all.
+ */
+class PredictBatcher {
+    public:
+        explicit PredictBatcher(std::shared_ptr<const fasttext::Model>);
+
+        /**
+         * One call to predict, from before its hidden vector is computed:
+         * batches led meanwhile wait for it to join.
+         */
+        class Arrival {
+            public:
+                // a batch led by this caller takes at most maxBatch requests
+                // and waits for them at most `window`
+                Arrival(PredictBatcher&, int32_t maxBatch,
+                            std::chrono::microseconds window);
+                ~Arrival();
+                Arrival(const Arrival&) = delete;
+                Arrival& operator=(const Arrival&) = delete;
+
+                // same as Model::predict from a hidden vector, but may be
+                // computed together with other callers
+                void predict(int32_t k,
+                            std::vector<std::pair<fasttext::real, int32_t>>& heap,
+                            fasttext::Vector& hidden, fasttext::Vector& output,
+                            fasttext::real threshold = 0.0);
+
+            private:
+                PredictBatcher& batcher_;
+                int32_t maxBatch_;
+                std::chrono::microseconds window_;
+                bool submitted_;
+        };
+
+    private:
+        struct Request {
+            int32_t k;
+            fasttext::real threshold;
+            std::vector<std::pair<fasttext::real, int32_t>>* heap;
+            fasttext::Vector* hidden;
+            fasttext::Vector* output;
+            bool done;
+            std::exception_ptr error;
+        };
+
+        struct Batch {
+            std::vector<Request*> requests;
+            size_t maxBatch;
+            std::condition_variable cv;
+        };
+
+        void submit(Request&, int32_t maxBatch, std::chrono::microseconds window);
+        void compute(const std::vector<Request*>&) const;
+
+        std::shared_ptr<const fasttext::Model> model_;
+        std::mutex mtx_;
+        // the batch accepting requests, if any
+        std::shared_ptr<Batch> open_;
+        // callers arrived but not submitted yet
+        int32_t arriving_;
+};
+
+#endif
@@ -0,0 +1,134 @@
+
+#include "predictFileWorker.h"
+#include <v8.h>
+
+#include <algorithm>
+
+#include "predictPipeline.h"
+
+void PredictFileWorker::Execute (const ExecutionProgress& progress) {
+    try {
+        wrapper_->loadModel();
+        wrapper_->precomputeSubwords();
+        if (!output_.empty()) {
+            stats_ = wrapper_->predictFile(input_, output_, k_, threshold_, threads_,
+                chunkLines_);
+        } else {
+            const int32_t maxUnconsumed =
+                PIPELINE_CHUNKS_PER_THREAD * std::max(1, threads_);
+            stats_ = wrapper_->predictFile(input_, k_, threshold_, threads_, chunkLines_,
+                [this, &progress, maxUnconsumed](PredictChunk& chunk) {
+                    {
+                        // holding the sink back holds the reader back too
+                        std::unique_lock<std::mutex> lock(unconsumedMtx_);
+                        unconsumedCv_.wait(lock, [this, maxUnconsumed] {
+                            return unconsumed_ < maxUnconsumed;
+                        });
+                        unconsumed_++;
+                    }
+                    // the main thread owns and frees it from here on
+                    PredictChunk* sent = new PredictChunk();
+                    sent->first = chunk.first;
+                    sent->results.swap(chunk.results);
+                    progress.Send(&sent, 1);
+                });
+        }
+    } catch (std::string errorMessage) {
+        SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        SetErrorMessage(str);
+    } catch(const std::exception& e) {
+        SetErrorMessage(e.what());
+    }
+}
+
+void PredictFileWorker::HandleProgressCallback (PredictChunk* const* chunks,
+        size_t count) {
+    Nan::HandleScope scope;
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+    for (size_t c = 0; c < count; c++) {
+        std::unique_ptr<PredictChunk> chunk(chunks[c]);
+        v8::Local<v8::Array> result = Nan::New<v8::Array>(chunk->results.size());
+
+        for (unsigned int s = 0; s < chunk->results.size(); s++) {
+            const std::vector<PredictResult>& predictions = chunk->results[s];
+            v8::Local<v8::Array> lineResult = Nan::New<v8::Array>(predictions.size());
+
+            for (unsigned int i = 0; i < predictions.size(); i++) {
+                v8::Local<v8::Object> returnObject = Nan::New<v8::Object>();
+
+                returnObject->Set(
+                    context,
+                    Nan::New<v8::String>("label").ToLocalChecked(),
+                    Nan::New<v8::String>(predictions[i].label.c_str()).ToLocalChecked()
+                );
+
+                returnObject->Set(
+                    context,
+                    Nan::New<v8::String>("value").ToLocalChecked(),
+                    Nan::New<v8::Number>(predictions[i].value)
+                );
+
+                lineResult->Set(context, i, returnObject);
+            }
+
+            result->Set(context, s, lineResult);
+        }
+
+        v8::Local<v8::Value> argv[] = {
+            result,
+            Nan::New<v8::Number>(chunk->first)
+        };
+
+        onChunk_->Call(2, argv);
+
+        std::lock_guard<std::mutex> lock(unconsumedMtx_);
+        unconsumed_--;
+        unconsumedCv_.notify_one();
+    }
+}
+
+void PredictFileWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage()),
+        Nan::Null()
+    };
+
+    callback->Call(2, argv);
+}
+
+void PredictFileWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("lines").ToLocalChecked(),
+        Nan::New<v8::Number>(stats_.lines)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("seconds").ToLocalChecked(),
+        Nan::New<v8::Number>(stats_.seconds)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("linesPerSecond").ToLocalChecked(),
+        Nan::New<v8::Number>(stats_.linesPerSecond)
+    );
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null(),
+        result
+    };
+
+    callback->Call(2, argv);
+}
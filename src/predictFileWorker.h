@@ -0,0 +1,59 @@
+#ifndef PREDICT_FILE_WORKER_H
+#define PREDICT_FILE_WORKER_H
+
+#include <nan.h>
+
+#include <condition_variable>
+#include <mutex>
+
+#include "wrapper.h"
+
+/**
+ * Predicts a whole file. The results are either written to `output`, or sent
+ * back to `onChunk` in file order, a chunk at a time. Only as many chunks as
+ * the pipeline keeps in flight wait for JS: past that, the pipeline waits.
+ */
+class PredictFileWorker : public Nan::AsyncProgressQueueWorker<PredictChunk*> {
+    public:
+        PredictFileWorker (Nan::Callback *callback, Nan::Callback *onChunk,
+                std::string input, std::string output, int32_t k, real threshold,
+                int32_t threads, int32_t chunkLines, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncProgressQueueWorker<PredictChunk*>(callback),
+                onChunk_(onChunk),
+                input_(input),
+                output_(output),
+                wrapper_(wrapper),
+                stats_(),
+                k_(k),
+                threshold_(threshold),
+                threads_(threads),
+                chunkLines_(chunkLines),
+                unconsumed_(0) {};
+
+        ~PredictFileWorker () {
+            delete onChunk_;
+        };
+
+        void Execute (const ExecutionProgress& progress);
+        void HandleProgressCallback (PredictChunk* const* chunks, size_t count);
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        Nan::Callback *onChunk_;
+        std::string input_;
+        std::string output_;
+        std::shared_ptr<Wrapper> wrapper_;
+        PredictFileStats stats_;
+        int32_t k_;
+        real threshold_;
+        int32_t threads_;
+        int32_t chunkLines_;
+
+        // chunks sent to the main thread that onChunk did not return from yet
+        std::mutex unconsumedMtx_;
+        std::condition_variable unconsumedCv_;
+        int32_t unconsumed_;
+};
+
+#endif
@@ -0,0 +1,154 @@
+
+#include "predictPipeline.h"
+
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+PredictPipeline::PredictPipeline(int32_t threads, int32_t chunkLines)
+    : threads_(threads < 1 ? 1 : threads),
+        chunkLines_(chunkLines < 1 ? 1 : chunkLines),
+        inFlight_(0),
+        lines_(0),
+        eof_(false) {}
+
+int64_t PredictPipeline::run(std::istream& in, const Work& work,
+        const Sink& sink) {
+    std::vector<std::thread> pool;
+    pool.push_back(std::thread([this, &in]() {
+        try {
+            read(in);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    }));
+    for (int32_t t = 0; t < threads_; t++) {
+        pool.push_back(std::thread([this, t, &work]() { this->work(t, work); }));
+    }
+
+    int64_t next = 0;
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        sinkCv_.wait(lock, [this, next] {
+            return error_ || done_.count(next) || (eof_ && next == lines_);
+        });
+        if (error_ || (eof_ && next == lines_)) {
+            break;
+        }
+        std::unique_ptr<PredictChunk> chunk = std::move(done_[next]);
+        done_.erase(next);
+        lock.unlock();
+        next += chunk->lines.size();
+        try {
+            sink(*chunk);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        lock.lock();
+        inFlight_--;
+        readerCv_.notify_one();
+    }
+    lock.unlock();
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    return lines_;
+}
+
+void PredictPipeline::read(std::istream& in) {
+    std::vector<char> buffer(PIPELINE_READ_BYTES);
+    std::unique_ptr<PredictChunk> chunk(new PredictChunk());
+    std::string line;
+
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        const char* p = buffer.data();
+        const char* end = p + in.gcount();
+        while (p < end) {
+            const char* eol = (const char*) memchr(p, '\n', end - p);
+            if (eol == NULL) {
+                line.append(p, end);
+                break;
+            }
+            line.append(p, eol);
+            p = eol + 1;
+            chunk->lines.push_back(std::move(line));
+            line.clear();
+            if (chunk->lines.size() == chunkLines_) {
+                if (!push(std::move(chunk))) {
+                    return;
+                }
+                chunk.reset(new PredictChunk());
+            }
+        }
+    }
+    if (!line.empty()) {
+        chunk->lines.push_back(std::move(line));
+    }
+    if (!chunk->lines.empty() && !push(std::move(chunk))) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    eof_ = true;
+    workerCv_.notify_all();
+    sinkCv_.notify_all();
+}
+
+bool PredictPipeline::push(std::unique_ptr<PredictChunk> chunk) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    readerCv_.wait(lock, [this] {
+        return error_ || inFlight_ < PIPELINE_CHUNKS_PER_THREAD * threads_;
+    });
+    if (error_) {
+        return false;
+    }
+    chunk->first = lines_;
+    lines_ += chunk->lines.size();
+    inFlight_++;
+    todo_.push_back(std::move(chunk));
+    workerCv_.notify_one();
+    return true;
+}
+
+void PredictPipeline::work(int32_t thread, const Work& work) {
+    while (true) {
+        std::unique_ptr<PredictChunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            workerCv_.wait(lock, [this] {
+                return error_ || eof_ || !todo_.empty();
+            });
+            if (error_ || todo_.empty()) {
+                return;
+            }
+            chunk = std::move(todo_.front());
+            todo_.pop_front();
+        }
+        try {
+            work(thread, *chunk);
+        } catch (...) {
+            fail(std::current_exception());
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        int64_t first = chunk->first;
+        done_[first] = std::move(chunk);
+        sinkCv_.notify_one();
+    }
+}
+
+void PredictPipeline::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!error_) {
+        error_ = error;
+    }
+    readerCv_.notify_all();
+    workerCv_.notify_all();
+    sinkCv_.notify_all();
+}
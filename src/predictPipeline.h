@@ -0,0 +1,66 @@
+
+#ifndef PREDICT_PIPELINE_H
+#define PREDICT_PIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <deque>
+
+#include "wrapper.h"
+
+constexpr int64_t PIPELINE_READ_BYTES = 1 << 20;
+// chunks read ahead of the sink, per worker
+constexpr int32_t PIPELINE_CHUNKS_PER_THREAD = 4;
+
+/**
+ * Ordered multi-threaded pass over the lines of a stream.
+ *
+ * A reader thread cuts the stream into chunks of whole lines with large
+ * reads, the workers process the chunks as they come, and the calling thread
+ * gets them back in stream order. Only a few chunks per worker are in flight
+ * at any time, so memory does not grow with the size of the input.
+ */
+class PredictPipeline {
+    public:
+        // work runs on a worker thread, numbered from 0 to threads - 1
+        typedef std::function<void(int32_t, PredictChunk&)> Work;
+        typedef std::function<void(PredictChunk&)> Sink;
+
+        PredictPipeline(int32_t threads, int32_t chunkLines);
+
+        // returns the number of lines read; the first exception of any
+        // stage stops the others and is rethrown here
+        int64_t run(std::istream&, const Work&, const Sink&);
+
+    private:
+        void read(std::istream&);
+        bool push(std::unique_ptr<PredictChunk>);
+        void work(int32_t thread, const Work&);
+        void fail(std::exception_ptr);
+
+        int32_t threads_;
+        size_t chunkLines_;
+
+        std::mutex mtx_;
+        std::condition_variable readerCv_;
+        std::condition_variable workerCv_;
+        std::condition_variable sinkCv_;
+
+        // read, waiting for a worker
+        std::deque<std::unique_ptr<PredictChunk>> todo_;
+        // processed, by first line, waiting for the sink
+        std::map<int64_t, std::unique_ptr<PredictChunk>> done_;
+        // read and not sunk yet
+        int32_t inFlight_;
+        int64_t lines_;
+        bool eof_;
+        std::exception_ptr error_;
+};
+
+#endif
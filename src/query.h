@@ -6,13 +6,14 @@
 #include <node_object_wrap.h>
 #include <nan.h>
 
-#include "nodeArgument.h"
-#include "wrapper.h"
+#include "modelObject.h"
 #include "nnWorker.h"
-#include "trainWorker.h"
+#include "buildIndexWorker.h"
+#include "evaluateIndexWorker.h"
 #include "vectorWorker.h"
+#include "vectorBatchWorker.h"
 
-class Query : public Nan::ObjectWrap {
+class Query : public ModelObject {
     public:
         static NAN_MODULE_INIT(Init) {
             v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
@@ -20,8 +21,16 @@ class Query : public Nan::ObjectWrap {
             tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
             Nan::SetPrototypeMethod(tpl, "nn", Nn);
+            Nan::SetPrototypeMethod(tpl, "buildIndex", BuildIndex);
+            Nan::SetPrototypeMethod(tpl, "evaluateIndex", EvaluateIndex);
             Nan::SetPrototypeMethod(tpl, "getSentenceVector", GetSentenceVector);
+            Nan::SetPrototypeMethod(tpl, "getSentenceVectors", GetSentenceVectors);
             Nan::SetPrototypeMethod(tpl, "train", Train);
+            Nan::SetPrototypeMethod(tpl, "saveModel", SaveModel);
+            Nan::SetPrototypeMethod(tpl, "load", Load);
+            Nan::SetPrototypeMethod(tpl, "reload", Reload);
+            Nan::SetPrototypeMethod(tpl, "setCache", SetCache);
+            Nan::SetPrototypeMethod(tpl, "cacheStats", GetCacheStats);
 
             constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
             Nan::Set(target, Nan::New("Query").ToLocalChecked(),
@@ -30,7 +39,7 @@ class Query : public Nan::ObjectWrap {
 
     private:
         explicit Query(std::string modelFilename) :
-            wrapper_(new Wrapper(modelFilename))
+            ModelObject(modelFilename, false)
             {}
 
         ~Query() {}
@@ -69,7 +78,28 @@ class Query : public Nan::ObjectWrap {
                 return;
             }
 
-            if (!info[2]->IsFunction()) {
+            // nn(query, k, [threads | options], callback)
+            int callbackIndex = 2;
+            int32_t threads = 1;
+            bool approximate = false;
+            int32_t efSearch = HNSW_DEFAULT_EF_SEARCH;
+            if (info[2]->IsUint32()) {
+                threads = info[2]->Int32Value(Nan::GetCurrentContext()).FromJust();
+                callbackIndex = 3;
+            } else if (info[2]->IsObject() && !info[2]->IsFunction()) {
+                v8::Local<v8::Object> options = info[2].As<v8::Object>();
+                try {
+                    threads = IntOption(options, "threads", threads);
+                    approximate = BoolOption(options, "approximate", approximate);
+                    efSearch = IntOption(options, "efSearch", efSearch);
+                } catch (std::string errorMessage) {
+                    Nan::ThrowError(errorMessage.c_str());
+                    return;
+                }
+                callbackIndex = 3;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
                 Nan::ThrowError("callback must be a function");
                 return;
             }
@@ -79,37 +109,90 @@ class Query : public Nan::ObjectWrap {
             // v8::String::Utf8Value queryArg(info[0]->ToString());
             Nan::Utf8String queryArg(info[0]);
             std::string query = std::string(*queryArg);
-            Nan::Callback *callback = new Nan::Callback(info[2].As<v8::Function>());
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
 
             Query* obj = Nan::ObjectWrap::Unwrap<Query>(info.Holder());
 
-            Nan::AsyncQueueWorker(new NnWorker(callback, query, k, obj->wrapper_));
+            NnWorker* worker = new NnWorker(callback, query, k, threads,
+                approximate, efSearch, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::INTERACTIVE);
         }
 
-        static NAN_METHOD(GetSentenceVector) {
-            if (!info[0]->IsString()) {
-                Nan::ThrowError("query must be a string");
+        static NAN_METHOD(BuildIndex) {
+            // buildIndex([options], callback)
+            int callbackIndex = 0;
+            int32_t M = HNSW_DEFAULT_M;
+            int32_t efConstruction = HNSW_DEFAULT_EF_CONSTRUCTION;
+            int32_t threads = 1;
+            if (info[0]->IsObject() && !info[0]->IsFunction()) {
+                v8::Local<v8::Object> options = info[0].As<v8::Object>();
+                try {
+                    M = IntOption(options, "M", M);
+                    efConstruction = IntOption(options, "efConstruction", efConstruction);
+                    threads = IntOption(options, "threads", threads);
+                } catch (std::string errorMessage) {
+                    Nan::ThrowError(errorMessage.c_str());
+                    return;
+                }
+                callbackIndex = 1;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
                 return;
             }
 
-            if (!info[1]->IsFunction()) {
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
+
+            Query* obj = Nan::ObjectWrap::Unwrap<Query>(info.Holder());
+
+            BuildIndexWorker* worker = new BuildIndexWorker(callback, M, efConstruction,
+                threads, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
+        }
+
+        static NAN_METHOD(EvaluateIndex) {
+            // evaluateIndex([options], callback)
+            int callbackIndex = 0;
+            int32_t samples = 100;
+            int32_t k = 10;
+            int32_t efSearch = HNSW_DEFAULT_EF_SEARCH;
+            int32_t threads = 1;
+            if (info[0]->IsObject() && !info[0]->IsFunction()) {
+                v8::Local<v8::Object> options = info[0].As<v8::Object>();
+                try {
+                    samples = IntOption(options, "samples", samples);
+                    k = IntOption(options, "k", k);
+                    efSearch = IntOption(options, "efSearch", efSearch);
+                    threads = IntOption(options, "threads", threads);
+                } catch (std::string errorMessage) {
+                    Nan::ThrowError(errorMessage.c_str());
+                    return;
+                }
+                callbackIndex = 1;
+            }
+
+            if (!info[callbackIndex]->IsFunction()) {
                 Nan::ThrowError("callback must be a function");
                 return;
             }
 
-            // v8::String::Utf8Value queryArg(info[0]->ToString());
-            Nan::Utf8String queryArg(info[0]);
-            std::string query = std::string(*queryArg);
-            Nan::Callback *callback = new Nan::Callback(info[1].As<v8::Function>());
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
 
             Query* obj = Nan::ObjectWrap::Unwrap<Query>(info.Holder());
 
-            Nan::AsyncQueueWorker(new VectorWorker(callback, query, obj->wrapper_));
+            EvaluateIndexWorker* worker = new EvaluateIndexWorker(callback, samples, k,
+                efSearch, threads, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::BULK);
         }
 
-        static NAN_METHOD(Train) {
-            if (!info[0]->IsObject()) {
-                Nan::ThrowError("options argument must be an object.");
+        static NAN_METHOD(GetSentenceVector) {
+            bool isBuffer = node::Buffer::HasInstance(info[0]);
+            if (!info[0]->IsString() && !isBuffer) {
+                Nan::ThrowError("query must be a string or a Buffer");
                 return;
             }
 
@@ -118,43 +201,86 @@ class Query : public Nan::ObjectWrap {
                 return;
             }
 
+            Nan::Callback *callback = new Nan::Callback(info[1].As<v8::Function>());
 
-            v8::Local<v8::Object> confObj = v8::Local<v8::Object>::Cast( info[0] );
+            Query* obj = Nan::ObjectWrap::Unwrap<Query>(info.Holder());
 
-            NodeArgument::NodeArgument nodeArg;
-            NodeArgument::CArgument c_argument;
+            VectorWorker* worker;
+            if (isBuffer) {
+                worker = new VectorWorker(callback, node::Buffer::Data(info[0]),
+                    node::Buffer::Length(info[0]), obj->wrapper_);
+                worker->SaveToPersistent("buffer", info[0]);
+            } else {
+                // v8::String::Utf8Value queryArg(info[0]->ToString());
+                Nan::Utf8String queryArg(info[0]);
+                std::string query = std::string(*queryArg);
+                worker = new VectorWorker(callback, query, obj->wrapper_);
+            }
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::INTERACTIVE);
+        }
 
-            try {
-                c_argument = nodeArg.ObjectToCArgument( confObj );
-            } catch (std::string errorMessage) {
-                Nan::ThrowError(errorMessage.c_str());
+        static NAN_METHOD(GetSentenceVectors) {
+            if (!info[0]->IsArray()) {
+                Nan::ThrowError("sentences must be an array");
                 return;
             }
 
-            int count = c_argument.argc;
-            char** argument = c_argument.argv;
+            // threads are optional: getSentenceVectors(sentences, [threads], callback)
+            int callbackIndex = 1;
+            int32_t threads = 1;
+            if (info[1]->IsUint32()) {
+                threads = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+                callbackIndex = 2;
+            }
 
-            std::vector<std::string> args;
-            args.push_back("-command");
-            args.push_back("skipgram");
+            if (!info[callbackIndex]->IsFunction()) {
+                Nan::ThrowError("callback must be a function");
+                return;
+            }
+
+            v8::Local<v8::Array> sentencesArg = info[0].As<v8::Array>();
+            std::vector<std::string> sentences;
+            sentences.reserve(sentencesArg->Length());
 
-            for(int j = 0; j < count; j++) {
-                args.push_back(argument[j]);
+            for (uint32_t i = 0; i < sentencesArg->Length(); i++) {
+                v8::Local<v8::Value> sentence = Nan::Get(sentencesArg, i).ToLocalChecked();
+                if (!sentence->IsString()) {
+                    Nan::ThrowError("sentences must contain only strings");
+                    return;
+                }
+                Nan::Utf8String sentenceArg(sentence);
+                sentences.push_back(std::string(*sentenceArg));
             }
 
-            Nan::Callback *callback = new Nan::Callback(info[1].As<v8::Function>());
+            Nan::Callback *callback = new Nan::Callback(info[callbackIndex].As<v8::Function>());
 
             Query* obj = Nan::ObjectWrap::Unwrap<Query>(info.Holder());
 
-            Nan::AsyncQueueWorker(new TrainWorker(callback, args, obj->wrapper_));
+            VectorBatchWorker* worker = new VectorBatchWorker(callback, sentences, threads, obj->wrapper_);
+            worker->SaveToPersistent("holder", info.Holder());
+            WorkerPool::queue(worker, WorkerPool::INTERACTIVE);
+        }
+
+        // train(options, [onProgress], callback), options.model being
+        // skipgram (the default) or cbow
+        static NAN_METHOD(Train) {
+            std::vector<std::string> args;
+            std::string model = "skipgram";
+            if (!TrainArguments(info, args, model)) {
+                return;
+            }
+            if (model != "skipgram" && model != "cbow") {
+                Nan::ThrowError("model must be skipgram or cbow");
+                return;
+            }
+            QueueTrain(info, model, args);
         }
 
         static inline Nan::Persistent<v8::Function> & constructor() {
             static Nan::Persistent<v8::Function> my_constructor;
             return my_constructor;
         }
-
-        Wrapper* wrapper_;
     };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+
+#include "resultCache.h"
+
+#include <functional>
+
+// rough cost of the list node, the hash map slot and the key copies
+constexpr int64_t RESULT_CACHE_ENTRY_OVERHEAD = 128;
+
+static bool isSpace(char c) {
+    // the separators of Dictionary::readWord
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' ||
+        c == '\f' || c == '\0';
+}
+
+ResultCache::ResultCache(int64_t maxBytes)
+    : maxBytes_(maxBytes),
+        shards_(new Shard[RESULT_CACHE_SHARDS]),
+        hits_(0),
+        misses_(0) {
+    for (int32_t i = 0; i < RESULT_CACHE_SHARDS; i++) {
+        shards_[i].bytes = 0;
+    }
+}
+
+std::string ResultCache::normalize(const std::string& text) {
+    return normalize(text.data(), text.size());
+}
+
+std::string ResultCache::normalize(const char* text, size_t length) {
+    std::string normalized;
+    normalized.reserve(length);
+    bool space = false;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '\n') {
+            // a newline is a token of its own (EOS), spaces around it are not
+            normalized.push_back(c);
+            space = false;
+        } else if (isSpace(c)) {
+            space = !normalized.empty() && normalized.back() != '\n';
+        } else {
+            if (space) {
+                normalized.push_back(' ');
+                space = false;
+            }
+            normalized.push_back(c);
+        }
+    }
+    return normalized;
+}
+
+std::string ResultCache::makeKey(const std::string& normalized, int32_t k,
+        real threshold) {
+    std::string key(reinterpret_cast<const char*>(&k), sizeof(int32_t));
+    key.append(reinterpret_cast<const char*>(&threshold), sizeof(real));
+    key.append(normalized);
+    return key;
+}
+
+ResultCache::Shard& ResultCache::shard(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % RESULT_CACHE_SHARDS];
+}
+
+bool ResultCache::get(const std::string& normalized, int32_t k,
+        real threshold, CachedResult& result) {
+    std::string key = makeKey(normalized, k, threshold);
+    Shard& s = shard(key);
+    {
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            result = it->second->result;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::put(const std::string& normalized, int32_t k,
+        real threshold, const CachedResult& result) {
+    std::string key = makeKey(normalized, k, threshold);
+    int64_t bytes = RESULT_CACHE_ENTRY_OVERHEAD + 2 * key.size() +
+        result.vector.size() * sizeof(real);
+    for (auto& prediction : result.predictions) {
+        bytes += sizeof(PredictResult) + prediction.label.size();
+    }
+    const int64_t limit = maxBytes_ / RESULT_CACHE_SHARDS;
+    if (bytes > limit) {
+        return;
+    }
+
+    Shard& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mtx);
+    if (s.index.count(key)) {
+        // computed by two requests at once
+        return;
+    }
+    s.lru.push_front({ key, result, bytes });
+    s.index[key] = s.lru.begin();
+    s.bytes += bytes;
+    while (s.bytes > limit) {
+        Entry& last = s.lru.back();
+        s.bytes -= last.bytes;
+        s.index.erase(last.key);
+        s.lru.pop_back();
+    }
+}
+
+CacheStats ResultCache::stats() const {
+    CacheStats stats = { hits_.load(), misses_.load(), 0, 0 };
+    for (int32_t i = 0; i < RESULT_CACHE_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards_[i].mtx);
+        stats.entries += shards_[i].index.size();
+        stats.bytes += shards_[i].bytes;
+    }
+    return stats;
+}
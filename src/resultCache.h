@@ -0,0 +1,82 @@
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "wrapper.h"
+
+constexpr int32_t RESULT_CACHE_SHARDS = 16;
+
+// what a cached request returned: predictions, or a sentence vector
+struct CachedResult {
+    std::vector<PredictResult> predictions;
+    std::vector<real> vector;
+};
+
+struct CacheStats {
+    int64_t hits;
+    int64_t misses;
+    int64_t entries;
+    int64_t bytes;
+};
+
+/**
+ * Bounded LRU cache of request results, for the few texts that make up most
+ * of the traffic.
+ *
+ * Entries are keyed by the whitespace-normalized text, an integer (k for
+ * predictions, -1 for vectors) and the threshold of predictions, which is all
+ * a result depends on for a given model. The keys are spread over shards with
+ * their own locks and their own share of the memory budget, so concurrent
+ * requests rarely contend.
+ */
+class ResultCache {
+    public:
+        explicit ResultCache(int64_t maxBytes);
+
+        // the tokens of the text joined by single spaces, newlines kept:
+        // texts that only differ this way are tokenized the same way
+        static std::string normalize(const std::string&);
+        static std::string normalize(const char*, size_t);
+
+        bool get(const std::string& normalized, int32_t k, real threshold,
+                    CachedResult&);
+        void put(const std::string& normalized, int32_t k, real threshold,
+                    const CachedResult&);
+
+        CacheStats stats() const;
+        int64_t maxBytes() const { return maxBytes_; }
+
+    private:
+        struct Entry {
+            std::string key;
+            CachedResult result;
+            int64_t bytes;
+        };
+
+        struct Shard {
+            std::mutex mtx;
+            // most recently used first
+            std::list<Entry> lru;
+            std::unordered_map<std::string, std::list<Entry>::iterator> index;
+            int64_t bytes;
+        };
+
+        static std::string makeKey(const std::string&, int32_t, real);
+        Shard& shard(const std::string& key);
+
+        int64_t maxBytes_;
+        std::unique_ptr<Shard[]> shards_;
+        std::atomic<int64_t> hits_;
+        std::atomic<int64_t> misses_;
+};
+
+#endif
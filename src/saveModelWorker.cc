@@ -0,0 +1,35 @@
+#include "saveModelWorker.h"
+#include <v8.h>
+
+void SaveModelWorker::Execute () {
+    try {
+        wrapper_->saveModel(filename_, mapped_);
+    } catch (std::string errorMessage) {
+        this->SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        this->SetErrorMessage(str);
+    } catch (const std::exception& e) {
+        this->SetErrorMessage(e.what());
+    }
+}
+
+
+void SaveModelWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage())
+    };
+
+    callback->Call(1, argv);
+}
+
+void SaveModelWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null()
+    };
+
+    callback->Call(1, argv);
+}
@@ -0,0 +1,28 @@
+#ifndef SAVE_MODEL_WORKER_H
+#define SAVE_MODEL_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class SaveModelWorker : public Nan::AsyncWorker {
+    public:
+        SaveModelWorker (Nan::Callback *callback, std::string filename, bool mapped,
+                std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                filename_(filename),
+                mapped_(mapped),
+                wrapper_(wrapper) {};
+
+        ~SaveModelWorker () {};
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        std::string filename_;
+        bool mapped_;
+        std::shared_ptr<Wrapper> wrapper_;
+};
+
+#endif
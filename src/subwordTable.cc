@@ -0,0 +1,43 @@
+
+#include "subwordTable.h"
+
+using fasttext::Dictionary;
+using fasttext::Matrix;
+using fasttext::Vector;
+
+SubwordTable::SubwordTable(const Dictionary& dict, std::shared_ptr<const Matrix> input)
+    : input_(input),
+        sums_(dict.nwords(), input->n_),
+        sizes_(dict.nwords()) {
+    Vector vec(input->n_);
+    sums_.zero();
+    for (int32_t i = 0; i < dict.nwords(); i++) {
+        const std::vector<int32_t>& ngrams = dict.getSubwords(i);
+        vec.zero();
+        for (auto it = ngrams.cbegin(); it != ngrams.cend(); ++it) {
+            vec.addRow(*input_, *it);
+        }
+        sums_.addRow(vec, i, 1.0);
+        sizes_[i] = ngrams.size();
+    }
+}
+
+int64_t SubwordTable::addLine(Vector& vec, const std::vector<int32_t>& line) const {
+    int64_t rows = 0;
+    for (auto it = line.cbegin(); it != line.cend(); ++it) {
+        // ids below nwords are vocabulary words, the others single rows
+        if (*it < sums_.m_) {
+            vec.addRow(sums_, *it);
+            rows += sizes_[*it];
+        } else {
+            vec.addRow(*input_, *it);
+            rows++;
+        }
+    }
+    return rows;
+}
+
+int32_t SubwordTable::addWord(Vector& vec, int32_t id) const {
+    vec.addRow(sums_, id);
+    return sizes_[id];
+}
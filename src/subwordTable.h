@@ -0,0 +1,36 @@
+
+#ifndef SUBWORD_TABLE_H
+#define SUBWORD_TABLE_H
+
+#include <memory>
+#include <vector>
+
+#include "../lib/src/fasttext.h"
+
+/**
+ * Sum of the input rows of the subwords of every vocabulary word.
+ *
+ * Lines read with Dictionary::getCompactLine keep a vocabulary word as one
+ * id, so the word costs one row add instead of one per subword. Every sum is
+ * accumulated in the order of getSubwords, so a single word gives exactly
+ * the vector the subword rows give when added one by one.
+ */
+class SubwordTable {
+    public:
+        SubwordTable(const fasttext::Dictionary&,
+                    std::shared_ptr<const fasttext::Matrix> input);
+
+        // adds the rows of a compact line, returns the number of input rows
+        // they stand for
+        int64_t addLine(fasttext::Vector&, const std::vector<int32_t>&) const;
+        // adds the rows of every subword of a vocabulary word, returns their
+        // number
+        int32_t addWord(fasttext::Vector&, int32_t) const;
+
+    private:
+        std::shared_ptr<const fasttext::Matrix> input_;
+        fasttext::Matrix sums_;
+        std::vector<int32_t> sizes_;
+};
+
+#endif
@@ -3,9 +3,15 @@
 #include "trainWorker.h"
 #include <v8.h>
 
-void TrainWorker::Execute () {
+void TrainWorker::Execute (const ExecutionProgress& progress) {
     try {
-        wrapper_->train(query_);
+        if (onProgress_ != NULL) {
+            wrapper_->train(query_, [&progress](const TrainProgress& current) {
+                progress.Send(&current, 1);
+            });
+        } else {
+            wrapper_->train(query_);
+        }
     } catch (std::string errorMessage) {
         this->SetErrorMessage(errorMessage.c_str());
     } catch (const char * str) {
@@ -17,6 +23,62 @@ void TrainWorker::Execute () {
     }
 }
 
+void TrainWorker::HandleProgressCallback (const TrainProgress* data, size_t count) {
+    Nan::HandleScope scope;
+    // only the latest progress is kept between two calls, and none is left
+    // when an earlier call already took it
+    if (count == 0) {
+        return;
+    }
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("progress").ToLocalChecked(),
+        Nan::New<v8::Number>(data->progress)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("tokens").ToLocalChecked(),
+        Nan::New<v8::Number>(data->tokens)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("seconds").ToLocalChecked(),
+        Nan::New<v8::Number>(data->seconds)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("wordsPerSecPerThread").ToLocalChecked(),
+        Nan::New<v8::Number>(data->wordsPerSecPerThread)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("lr").ToLocalChecked(),
+        Nan::New<v8::Number>(data->lr)
+    );
+
+    result->Set(
+        context,
+        Nan::New<v8::String>("loss").ToLocalChecked(),
+        Nan::New<v8::Number>(data->loss)
+    );
+
+    v8::Local<v8::Value> argv[] = {
+        result
+    };
+
+    v8::Local<v8::Value> keepGoing;
+    if (Nan::Call(*onProgress_, 1, argv).ToLocal(&keepGoing) && keepGoing->IsFalse()) {
+        wrapper_->abortTraining();
+    }
+}
 
 void TrainWorker::HandleErrorCallback () {
     Nan::HandleScope scope;
@@ -31,9 +93,17 @@ void TrainWorker::HandleErrorCallback () {
 void TrainWorker::HandleOKCallback () {
     Nan::HandleScope scope;
 
+    if (!publish_(wrapper_)) {
+        v8::Local<v8::Value> argv[] = {
+            Nan::Error("Superseded by a later reload or train!")
+        };
+        callback->Call(1, argv);
+        return;
+    }
+
     v8::Local<v8::Value> argv[] = {
         Nan::Null()
     };
 
     callback->Call(1, argv);
-}
\ No newline at end of file
+}
@@ -3,24 +3,47 @@
 #define TRAIN_WORKER_H
 
 #include <nan.h>
+
+#include <functional>
+
 #include "wrapper.h"
 
-class TrainWorker : public Nan::AsyncWorker {
+/**
+ * Trains a new wrapper off the main thread, then publishes it on the main
+ * thread before the callback: requests still running on the previous model
+ * never see one being trained.
+ *
+ * The latest progress goes to onProgress while training runs. When it
+ * returns false the training stops, and the callback gets an error.
+ */
+class TrainWorker : public Nan::AsyncProgressWorkerBase<TrainProgress> {
     public:
-        TrainWorker (Nan::Callback *callback, std::vector<std::string> query, Wrapper *wrapper)
-            : Nan::AsyncWorker(callback),
+        // false when the wrapper was not swapped in
+        typedef std::function<bool(std::shared_ptr<Wrapper>)> Publish;
+
+        TrainWorker (Nan::Callback *callback, Nan::Callback *onProgress,
+                std::vector<std::string> query, std::shared_ptr<Wrapper> wrapper,
+                Publish publish)
+            : Nan::AsyncProgressWorkerBase<TrainProgress>(callback),
+                onProgress_(onProgress),
                 query_(query),
-                wrapper_(wrapper) {};
+                wrapper_(wrapper),
+                publish_(publish) {};
 
-        ~TrainWorker () {};
+        ~TrainWorker () {
+            delete onProgress_;
+        };
 
-        void Execute ();
+        void Execute (const ExecutionProgress& progress);
+        void HandleProgressCallback (const TrainProgress* data, size_t count);
         void HandleOKCallback ();
         void HandleErrorCallback ();
 
     private:
+        Nan::Callback *onProgress_;
         std::vector<std::string> query_;
-        Wrapper *wrapper_;
+        std::shared_ptr<Wrapper> wrapper_;
+        Publish publish_;
 };
 
-#endif
\ No newline at end of file
+#endif
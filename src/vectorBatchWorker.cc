@@ -0,0 +1,45 @@
+
+#include "vectorBatchWorker.h"
+#include "float32Array.h"
+#include <v8.h>
+
+void VectorBatchWorker::Execute () {
+    try {
+        wrapper_->loadModel(false);
+        wrapper_->precomputeSubwords();
+        dim_ = wrapper_->getDimension();
+        result_ = new real[sentences_.size() * dim_];
+        wrapper_->getSentenceVectors(sentences_, result_, threads_);
+    } catch (std::string errorMessage) {
+        this->SetErrorMessage(errorMessage.c_str());
+    } catch (const char * str) {
+        this->SetErrorMessage(str);
+    } catch (const std::exception& e) {
+        this->SetErrorMessage(e.what());
+    }
+}
+
+
+void VectorBatchWorker::HandleErrorCallback () {
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[] = {
+        Nan::Error(ErrorMessage()),
+        Nan::Null()
+    };
+
+    callback->Call(2, argv);
+}
+
+void VectorBatchWorker::HandleOKCallback () {
+    Nan::HandleScope scope;
+
+    // one row of dim values per sentence
+    v8::Local<v8::Value> argv[] = {
+        Nan::Null(),
+        NewFloat32Array(result_, sentences_.size() * dim_)
+    };
+    result_ = nullptr;
+
+    callback->Call(2, argv);
+}
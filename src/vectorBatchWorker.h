@@ -0,0 +1,36 @@
+
+#ifndef VECTOR_BATCH_WORKER_H
+#define VECTOR_BATCH_WORKER_H
+
+#include <nan.h>
+#include "wrapper.h"
+
+class VectorBatchWorker : public Nan::AsyncWorker {
+    public:
+        VectorBatchWorker (Nan::Callback *callback, std::vector<std::string> sentences,
+                int32_t threads, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                sentences_(sentences),
+                threads_(threads),
+                wrapper_(wrapper),
+                result_(nullptr),
+                dim_(0) {};
+
+        // the result is only still owned here when it was never handed to JS
+        ~VectorBatchWorker () {
+            delete[] result_;
+        };
+
+        void Execute ();
+        void HandleOKCallback ();
+        void HandleErrorCallback ();
+
+    private:
+        std::vector<std::string> sentences_;
+        int32_t threads_;
+        std::shared_ptr<Wrapper> wrapper_;
+        real* result_;
+        int32_t dim_;
+};
+
+#endif
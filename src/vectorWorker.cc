@@ -1,13 +1,21 @@
 
 
 #include "vectorWorker.h"
+#include "float32Array.h"
 #include <v8.h>
 
 void VectorWorker::Execute () {
     try {
-        wrapper_->loadModel();
+        wrapper_->loadModel(false);
+        wrapper_->precomputeSubwords();
         wrapper_->precomputeWordVectors();
-        result_ = wrapper_->getSentenceVector(query_);
+        dim_ = wrapper_->getDimension();
+        result_ = new real[dim_];
+        if (data_) {
+            wrapper_->getSentenceVector(data_, length_, result_);
+        } else {
+            wrapper_->getSentenceVector(query_.data(), query_.size(), result_);
+        }
     } catch (std::string errorMessage) {
         this->SetErrorMessage(errorMessage.c_str());
     } catch (const char * str) {
@@ -33,18 +41,12 @@ void VectorWorker::HandleErrorCallback () {
 
 void VectorWorker::HandleOKCallback () {
     Nan::HandleScope scope;
-    v8::Isolate* isolate = v8::Isolate::GetCurrent();
-    v8::Local<v8::Context> context =isolate->GetCurrentContext();
-    v8::Local<v8::Array> result = Nan::New<v8::Array>(result_.size());
-
-    for(unsigned int i = 0; i < result_.size(); i++) {
-        result->Set(context, i, Nan::New<v8::Number>(result_[i]));
-    }
 
     v8::Local<v8::Value> argv[] = {
         Nan::Null(),
-        result
+        NewFloat32Array(result_, dim_)
     };
+    result_ = nullptr;
 
     callback->Call(2, argv);
-}
\ No newline at end of file
+}
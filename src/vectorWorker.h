@@ -7,13 +7,29 @@
 
 class VectorWorker : public Nan::AsyncWorker {
     public:
-        VectorWorker (Nan::Callback *callback, std::string query, Wrapper *wrapper)
+        VectorWorker (Nan::Callback *callback, std::string query, std::shared_ptr<Wrapper> wrapper)
             : Nan::AsyncWorker(callback),
                 query_(query),
+                data_(nullptr),
+                length_(0),
                 wrapper_(wrapper),
-                result_() {};
+                result_(nullptr),
+                dim_(0) {};
 
-        ~VectorWorker () {};
+        // reads the bytes in place, see ClassifierWorker
+        VectorWorker (Nan::Callback *callback, const char* data, size_t length, std::shared_ptr<Wrapper> wrapper)
+            : Nan::AsyncWorker(callback),
+                query_(),
+                data_(data),
+                length_(length),
+                wrapper_(wrapper),
+                result_(nullptr),
+                dim_(0) {};
+
+        // the result is only still owned here when it was never handed to JS
+        ~VectorWorker () {
+            delete[] result_;
+        };
 
         void Execute ();
         void HandleOKCallback ();
@@ -21,8 +37,11 @@ class VectorWorker : public Nan::AsyncWorker {
 
     private:
         std::string query_;
-        Wrapper *wrapper_;
-        std::vector<double> result_;
+        const char* data_;
+        size_t length_;
+        std::shared_ptr<Wrapper> wrapper_;
+        real* result_;
+        int32_t dim_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,85 @@
+
+#include "workerPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+WorkerPool::WorkerPool() : pending_(0) {
+    lanes_[INTERACTIVE].size = std::max(1u, std::thread::hardware_concurrency());
+    lanes_[BULK].size = 1;
+    uv_async_init(Nan::GetCurrentEventLoop(), &async_, complete);
+    async_.data = this;
+    // only keeps the process alive while some job is pending
+    uv_unref(reinterpret_cast<uv_handle_t*>(&async_));
+}
+
+WorkerPool& WorkerPool::instance() {
+    // never destroyed: its threads run until the process exits
+    static WorkerPool* pool = new WorkerPool();
+    return *pool;
+}
+
+void WorkerPool::configure(Queue queue, int32_t threads) {
+    WorkerPool& pool = instance();
+    std::lock_guard<std::mutex> lock(pool.mtx_);
+    Lane& lane = pool.lanes_[queue];
+    if (!lane.threads.empty()) {
+        throw std::invalid_argument("Thread pool is already running!");
+    }
+    if (threads < 1) {
+        throw std::invalid_argument("Thread pool needs at least one thread!");
+    }
+    lane.size = threads;
+}
+
+void WorkerPool::queue(Nan::AsyncWorker* worker, Queue queue) {
+    WorkerPool& pool = instance();
+    if (pool.pending_++ == 0) {
+        uv_ref(reinterpret_cast<uv_handle_t*>(&pool.async_));
+    }
+    std::lock_guard<std::mutex> lock(pool.mtx_);
+    Lane& lane = pool.lanes_[queue];
+    if (lane.threads.empty()) {
+        for (int32_t i = 0; i < lane.size; i++) {
+            lane.threads.push_back(std::thread(&WorkerPool::run, &pool, std::ref(lane)));
+            lane.threads.back().detach();
+        }
+    }
+    lane.jobs.push_back(worker);
+    lane.cv.notify_one();
+}
+
+void WorkerPool::run(Lane& lane) {
+    while (true) {
+        Nan::AsyncWorker* worker;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            lane.cv.wait(lock, [&lane]() { return !lane.jobs.empty(); });
+            worker = lane.jobs.front();
+            lane.jobs.pop_front();
+        }
+        worker->Execute();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            done_.push_back(worker);
+        }
+        uv_async_send(&async_);
+    }
+}
+
+void WorkerPool::complete(uv_async_t* handle) {
+    WorkerPool& pool = *static_cast<WorkerPool*>(handle->data);
+    std::vector<Nan::AsyncWorker*> done;
+    {
+        std::lock_guard<std::mutex> lock(pool.mtx_);
+        done.swap(pool.done_);
+    }
+    for (Nan::AsyncWorker* worker : done) {
+        worker->WorkComplete();
+        worker->Destroy();
+    }
+    pool.pending_ -= done.size();
+    if (pool.pending_ == 0) {
+        uv_unref(reinterpret_cast<uv_handle_t*>(&pool.async_));
+    }
+}
@@ -0,0 +1,52 @@
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <nan.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Native threads running the model workers, apart from the libuv threadpool.
+ *
+ * Interactive jobs (predictions, nn, vectors) and bulk jobs (training, index
+ * builds, model conversion) have their own queues and threads: a long bulk
+ * job never delays a prediction, and neither waits behind fs or crypto work
+ * in the libuv pool. Finished workers go back to the event loop through a
+ * uv_async handle, where their callbacks run as with Nan::AsyncQueueWorker.
+ */
+class WorkerPool {
+    public:
+        enum Queue { INTERACTIVE = 0, BULK = 1 };
+
+        // both must be called from the main thread
+        static void queue(Nan::AsyncWorker*, Queue);
+        // sets the number of threads of a queue, only before its first job
+        static void configure(Queue, int32_t threads);
+
+    private:
+        struct Lane {
+            std::deque<Nan::AsyncWorker*> jobs;
+            std::vector<std::thread> threads;
+            std::condition_variable cv;
+            int32_t size;
+        };
+
+        WorkerPool();
+        static WorkerPool& instance();
+        static void complete(uv_async_t*);
+        void run(Lane&);
+
+        Lane lanes_[2];
+        std::mutex mtx_;
+        std::vector<Nan::AsyncWorker*> done_;
+        uv_async_t async_;
+        // jobs queued and not completed yet, main thread only
+        int64_t pending_;
+};
+
+#endif
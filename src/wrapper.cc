@@ -2,56 +2,90 @@
 
 
 #include "wrapper.h"
+#include "inferenceScratch.h"
+#include "mappedModel.h"
+#include "predictPipeline.h"
+#include "resultCache.h"
 
+#include <ctype.h>
 #include <math.h>
+#include <stdio.h>
 
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <thread>
 #include <string>
 #include <vector>
-#include <queue>
 #include <algorithm>
+#include <chrono>
+#include <exception>
 
 
-constexpr int32_t FASTTEXT_VERSION = 12; /* Version 1b */
-constexpr int32_t FASTTEXT_FILEFORMAT_MAGIC_INT32 = 793712314;
-
 using fasttext::model_name;
 using fasttext::entry_type;
 
+// Runs fn(thread, from, to) over [0, n) split into `threads` slices and
+// rethrows the first exception raised by any of the slices.
+template <typename F>
+static void parallelFor(int32_t threads, int32_t n, F fn) {
+    if (threads <= 1) {
+        fn(0, 0, n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    std::vector<std::exception_ptr> errors(threads);
+    for (int32_t t = 0; t < threads; t++) {
+        int32_t from = (int64_t) n * t / threads;
+        int32_t to = (int64_t) n * (t + 1) / threads;
+        pool.push_back(std::thread([&, t, from, to]() {
+            try {
+                fn(t, from, to);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
 Wrapper::Wrapper(std::string modelFilename)
-    : quant_(false),
+    : batchSize_(1),
+        batchWindowMicros_(0),
+        abortTraining_(false),
+        quant_(false),
         modelFilename_(modelFilename),
         isLoaded_(false),
-        isPrecomputed_(false) {}
+        hasOutput_(false),
+        isPrecomputed_(false),
+        isSubwordsPrecomputed_(false),
+        useSubwordTable_(false) {}
 
 void Wrapper::getVector(Vector& vec, const std::string& word) {
-    const std::vector<int32_t>& ngrams = dict_->getSubwords(word);
     vec.zero();
+    const SubwordTable* subwords = subwordTable();
+    int32_t id = subwords ? dict_->getId(word) : -1;
+    if (id >= 0) {
+        vec.mul(1.0 / subwords->addWord(vec, id));
+        return;
+    }
+    const std::vector<int32_t>& ngrams = dict_->getSubwords(word);
     for (auto it = ngrams.begin(); it != ngrams.end(); ++it) {
-        vec.addRow(*input_, *it);
+        addInputVector(vec, *it);
     }
     if (ngrams.size() > 0) {
         vec.mul(1.0 / ngrams.size());
     }
 }
 
-bool Wrapper::checkModel(std::istream& in) {
-    int32_t magic;
-    int32_t version;
-    in.read((char*)&(magic), sizeof(int32_t));
-    if (magic != FASTTEXT_FILEFORMAT_MAGIC_INT32) {
-        return false;
-    }
-    in.read((char*)&(version), sizeof(int32_t));
-    if (version != FASTTEXT_VERSION) {
-        return false;
-    }
-    return true;
-}
-
 void Wrapper::signModel(std::ostream& out) {
     const int32_t magic = FASTTEXT_FILEFORMAT_MAGIC_INT32;
     const int32_t version = FASTTEXT_VERSION;
@@ -59,126 +93,394 @@ void Wrapper::signModel(std::ostream& out) {
     out.write((char*)&(version), sizeof(int32_t));
 }
 
-void Wrapper::loadModel() {
-    if (isLoaded_) {
+void Wrapper::saveModel(const std::string& filename, bool mapped) {
+    loadModel();
+    if (mapped) {
+        SharedModel m;
+        m.args = args_;
+        m.dict = dict_;
+        m.input = input_;
+        m.output = output_;
+        m.qinput = qinput_;
+        m.qoutput = qoutput_;
+        m.quant = quant_;
+        MappedModel::save(m, filename);
         return;
     }
-    mtx_.lock();
-    if (isLoaded_) {
-        mtx_.unlock();
+
+    // readers must never see a half written file
+    std::string tmpFilename = filename + ".tmp";
+    std::vector<char> buffer(MODEL_WRITE_BUFFER_SIZE);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    out.open(tmpFilename, std::ofstream::binary);
+    if (!out.is_open()) {
+        throw std::invalid_argument(filename + " cannot be opened for saving!");
+    }
+    signModel(out);
+    args_->save(out);
+    dict_->save(out);
+
+    out.write((char*)&(quant_), sizeof(bool));
+    if (quant_) {
+        qinput_->save(out);
+    } else {
+        input_->save(out);
+    }
+
+    out.write((char*)&(args_->qout), sizeof(bool));
+    if (quant_ && args_->qout) {
+        qoutput_->save(out);
+    } else {
+        output_->save(out);
+    }
+    out.close();
+    if (out.fail()) {
+        remove(tmpFilename.c_str());
+        throw std::runtime_error(filename + " cannot be written!");
+    }
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        remove(tmpFilename.c_str());
+        throw std::runtime_error(filename + " cannot be written!");
+    }
+}
+
+void Wrapper::loadModel(bool withOutput) {
+    if (isLoaded_ && (hasOutput_ || !withOutput)) {
         return;
     }
-    std::ifstream ifs(this->modelFilename_, std::ifstream::binary);
-    if (!ifs.is_open()) {
-        throw "Model file cannot be opened for loading!";
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (isLoaded_ && (hasOutput_ || !withOutput)) {
+        return;
+    }
+    if (!shared_) {
+        shared_ = ModelRegistry::acquire(this->modelFilename_, withOutput);
+    } else {
+        shared_->loadOutput();
+    }
+    if (!isLoaded_) {
+        // once loaded, requests read these without the lock: adding the
+        // output must not assign them again
+        args_ = shared_->args;
+        dict_ = shared_->dict;
+        input_ = shared_->input;
+        output_ = shared_->output;
+        qinput_ = shared_->qinput;
+        qoutput_ = shared_->qoutput;
+        quant_ = shared_->quant;
     }
-    if (!checkModel(ifs)) {
-        throw "Model file has wrong file format!";
+    {
+        std::lock_guard<std::mutex> outputLock(shared_->outputMtx);
+        model_ = shared_->model;
+        batcher_ = shared_->batcher;
+        hasOutput_ = shared_->hasOutput;
     }
-    loadModel(ifs);
-    ifs.close();
     isLoaded_ = true;
-    mtx_.unlock();
 }
 
-void Wrapper::loadModel(std::istream& in) {
-    args_ = std::make_shared<Args>();
-    dict_ = std::make_shared<Dictionary>(args_);
-    input_ = std::make_shared<Matrix>();
-    output_ = std::make_shared<Matrix>();
-    qinput_ = std::make_shared<QMatrix>();
-    qoutput_ = std::make_shared<QMatrix>();
-    args_->load(in);
-
-    dict_->load(in);
-
-    bool quant_input;
-    in.read((char*) &quant_input, sizeof(bool));
-    if (quant_input) {
-        quant_ = true;
-        qinput_->load(in);
-    } else {
-        input_->load(in);
+// reads one value per page, so that a mapped matrix is resident before the
+// first request needs it
+static void prefault(const Matrix& matrix) {
+    const int64_t size = matrix.m_ * matrix.n_;
+    const int64_t stride = fasttext::MAPPED_PAGE_SIZE / sizeof(real);
+    real sum = 0;
+    for (int64_t i = 0; i < size; i += stride) {
+        sum += matrix.data_[i];
     }
+    volatile real sink = sum;
+    (void) sink;
+}
 
-    in.read((char*) &args_->qout, sizeof(bool));
-    if (quant_ && args_->qout) {
-        qoutput_->load(in);
-    } else {
-        output_->load(in);
+void Wrapper::warmUp(bool predictions) {
+    loadModel(predictions);
+    precomputeSubwords();
+    if (!predictions) {
+        precomputeWordVectors();
+        return;
+    }
+    if (!quant_) {
+        prefault(*input_);
+    }
+    if (!quant_ || !args_->qout) {
+        prefault(*output_);
     }
+}
 
-    model_ = std::make_shared<Model>(input_, output_, args_, 0);
-    model_->quant_ = quant_;
-    model_->setQuantizePointer(qinput_, qoutput_, args_->qout);
+void Wrapper::copySettings(const Wrapper& other) {
+    batchSize_ = other.batchSize_.load();
+    batchWindowMicros_ = other.batchWindowMicros_.load();
+    // the size only: cached results belong to the other model
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&other.cache_);
+    setCache(cache ? cache->maxBytes() : 0);
+}
 
-    if (args_->model == model_name::sup) {
-        model_->setTargetCounts(dict_->getCounts(entry_type::label));
-    } else {
-        model_->setTargetCounts(dict_->getCounts(entry_type::word));
+void Wrapper::setCache(int64_t maxBytes) {
+    if (maxBytes < 0) {
+        throw std::invalid_argument("Invalid cache size!");
     }
+    std::shared_ptr<ResultCache> cache;
+    if (maxBytes > 0) {
+        cache = std::make_shared<ResultCache>(maxBytes);
+    }
+    std::atomic_store(&cache_, cache);
+}
+
+CacheStats Wrapper::cacheStats() const {
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&cache_);
+    if (!cache) {
+        return { 0, 0, 0, 0 };
+    }
+    return cache->stats();
 }
 
 void Wrapper::precomputeWordVectors() {
     if (isPrecomputed_) {
         return;
     }
-    precomputeMtx_.lock();
+    std::lock_guard<std::mutex> lock(precomputeMtx_);
     if (isPrecomputed_) {
-        precomputeMtx_.unlock();
         return;
     }
-    Matrix wordVectors(dict_->nwords(), args_->dim);
-    wordVectors_ = wordVectors;
+    if (shared_) {
+        // the first wrapper over a shared model computes the vectors for all
+        std::lock_guard<std::mutex> sharedLock(shared_->precomputeMtx);
+        if (!shared_->wordVectors) {
+            shared_->wordVectors = computeWordVectors();
+        }
+        wordVectors_ = shared_->wordVectors;
+    } else {
+        wordVectors_ = computeWordVectors();
+    }
+    isPrecomputed_ = true;
+}
+
+void Wrapper::setSubwordTable(bool enabled) {
+    useSubwordTable_ = enabled;
+}
+
+void Wrapper::precomputeSubwords() {
+    if (!useSubwordTable_ || isSubwordsPrecomputed_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(precomputeMtx_);
+    if (isSubwordsPrecomputed_) {
+        return;
+    }
+    // a table only pays off when words have subwords, and it would undo
+    // the memory saved by a quantized input
+    if (args_->maxn > 0 && !quant_) {
+        if (shared_) {
+            std::lock_guard<std::mutex> sharedLock(shared_->subwordsMtx);
+            if (!shared_->subwords) {
+                shared_->subwords = std::make_shared<SubwordTable>(*dict_, input_);
+            }
+            subwords_ = shared_->subwords;
+        } else {
+            subwords_ = std::make_shared<SubwordTable>(*dict_, input_);
+        }
+    }
+    isSubwordsPrecomputed_ = true;
+}
+
+std::shared_ptr<Matrix> Wrapper::computeWordVectors() {
+    std::shared_ptr<Matrix> wordVectors =
+        std::make_shared<Matrix>(dict_->nwords(), args_->dim);
     Vector vec(args_->dim);
-    wordVectors_.zero();
+    wordVectors->zero();
     for (int32_t i = 0; i < dict_->nwords(); i++) {
         std::string word = dict_->getWord(i);
         getVector(vec, word);
         real norm = vec.norm();
-        wordVectors_.addRow(vec, i, 1.0 / norm);
+        wordVectors->addRow(vec, i, 1.0 / norm);
     }
-    isPrecomputed_ = true;
-    precomputeMtx_.unlock();
+    return wordVectors;
+}
+
+// rows scanned by one nn thread at least, smaller scans are not worth a thread
+constexpr int32_t NN_MIN_ROWS_PER_THREAD = 16384;
+
+static bool compareNN(const std::pair<real, int32_t>& l,
+        const std::pair<real, int32_t>& r) {
+    return l.first > r.first;
 }
 
 std::vector<PredictResult> Wrapper::findNN(const Vector& queryVec, int32_t k,
-        const std::set<std::string>& banSet) {
+        const std::set<int32_t>& banSet, int32_t threads) {
 
+    if (k <= 0) {
+        return std::vector<PredictResult>();
+    }
     real queryNorm = queryVec.norm();
     if (std::abs(queryNorm) < 1e-8) {
         queryNorm = 1;
     }
-    std::priority_queue<std::pair<real, std::string>> heap;
-    Vector vec(args_->dim);
-    for (int32_t i = 0; i < dict_->nwords(); i++) {
-        std::string word = dict_->getWord(i);
-        real dp = wordVectors_.dotRow(queryVec, i);
-        heap.push(std::make_pair(dp / queryNorm, word));
+    const int32_t nwords = dict_->nwords();
+    threads = std::max(1, std::min(threads, nwords / NN_MIN_ROWS_PER_THREAD));
+
+    // every thread keeps a min-heap of its k best (score, word id) pairs
+    std::vector<std::vector<std::pair<real, int32_t>>> heaps(threads);
+    auto scan = [&](int32_t t, int32_t from, int32_t to) {
+        std::vector<std::pair<real, int32_t>>& heap = heaps[t];
+        heap.reserve(k + 1);
+        for (int32_t i = from; i < to; i++) {
+            real dp = wordVectors_->dotRow(queryVec, i) / queryNorm;
+            if (heap.size() == static_cast<size_t>(k) && dp <= heap.front().first) {
+                continue;
+            }
+            if (banSet.count(i)) {
+                continue;
+            }
+            heap.push_back(std::make_pair(dp, i));
+            std::push_heap(heap.begin(), heap.end(), compareNN);
+            if (heap.size() > static_cast<size_t>(k)) {
+                std::pop_heap(heap.begin(), heap.end(), compareNN);
+                heap.pop_back();
+            }
+        }
+    };
+
+    parallelFor(threads, nwords, scan);
+
+    std::vector<std::pair<real, int32_t>> best;
+    for (auto& heap : heaps) {
+        best.insert(best.end(), heap.begin(), heap.end());
+    }
+    std::sort(best.begin(), best.end(), compareNN);
+    if (best.size() > static_cast<size_t>(k)) {
+        best.resize(k);
     }
 
-    PredictResult response;
     std::vector<PredictResult> arr;
-    int32_t i = 0;
-    while (i < k && heap.size() > 0) {
-        auto it = banSet.find(heap.top().second);
-        if (it == banSet.end()) {
-            response = { heap.top().second, exp(heap.top().first) };
-            arr.push_back(response);
-            i++;
-        }
-        heap.pop();
+    for (auto it = best.cbegin(); it != best.cend(); it++) {
+        arr.push_back({ dict_->getWord(it->second), exp(it->first) });
     }
     return arr;
 }
 
-std::vector<PredictResult> Wrapper::nn(std::string query, int32_t k) {
+std::vector<PredictResult> Wrapper::nn(std::string query, int32_t k,
+        int32_t threads) {
+    Vector queryVec(args_->dim);
+    std::set<int32_t> banSet;
+    int32_t id = dict_->getId(query);
+    if (id >= 0) {
+        banSet.insert(id);
+    }
+    getVector(queryVec, query);
+    return findNN(queryVec, k, banSet, threads);
+}
+
+std::shared_ptr<HnswIndex> Wrapper::loadIndex(int32_t threads) {
+    std::lock_guard<std::mutex> lock(indexMtx_);
+    if (index_) {
+        return index_;
+    }
+    if (!shared_) {
+        index_ = HnswIndex::build(wordVectors_, HNSW_DEFAULT_M,
+            HNSW_DEFAULT_EF_CONSTRUCTION, threads);
+        return index_;
+    }
+
+    // the sidecar next to the model is reused as long as the model is unchanged
+    std::lock_guard<std::mutex> sharedLock(shared_->indexMtx);
+    if (!shared_->index) {
+        shared_->index = HnswIndex::load(modelFilename_, wordVectors_);
+    }
+    if (!shared_->index) {
+        shared_->index = HnswIndex::build(wordVectors_, HNSW_DEFAULT_M,
+            HNSW_DEFAULT_EF_CONSTRUCTION, threads);
+        try {
+            shared_->index->save(modelFilename_);
+        } catch (...) {
+            // a read-only model directory only costs a rebuild next time
+        }
+    }
+    index_ = shared_->index;
+    return index_;
+}
+
+void Wrapper::buildIndex(int32_t M, int32_t efConstruction, int32_t threads) {
+    std::shared_ptr<HnswIndex> index =
+        HnswIndex::build(wordVectors_, M, efConstruction, threads);
+
+    std::lock_guard<std::mutex> lock(indexMtx_);
+    if (shared_) {
+        index->save(modelFilename_);
+        std::lock_guard<std::mutex> sharedLock(shared_->indexMtx);
+        shared_->index = index;
+    }
+    index_ = index;
+}
+
+std::vector<PredictResult> Wrapper::approximateNn(std::string query, int32_t k,
+        int32_t efSearch, int32_t threads) {
+    std::shared_ptr<HnswIndex> index = loadIndex(threads);
+
     Vector queryVec(args_->dim);
-    std::set<std::string> banSet;
-    banSet.clear();
-    banSet.insert(query);
+    std::set<int32_t> banSet;
+    int32_t id = dict_->getId(query);
+    if (id >= 0) {
+        banSet.insert(id);
+    }
     getVector(queryVec, query);
-    return findNN(queryVec, k, banSet);
+    real queryNorm = queryVec.norm();
+    if (std::abs(queryNorm) < 1e-8) {
+        queryNorm = 1;
+    }
+
+    std::vector<PredictResult> arr;
+    for (auto& found : index->search(queryVec, k, efSearch, banSet)) {
+        arr.push_back({ dict_->getWord(found.second), exp(found.first / queryNorm) });
+    }
+    return arr;
+}
+
+IndexEvaluation Wrapper::evaluateIndex(int32_t samples, int32_t k,
+        int32_t efSearch, int32_t threads) {
+    std::shared_ptr<HnswIndex> index = loadIndex(threads);
+    const int32_t nwords = dict_->nwords();
+
+    IndexEvaluation evaluation = { std::max(0, std::min(samples, nwords)), 1.0, 0.0, 0.0 };
+    if (evaluation.samples == 0) {
+        return evaluation;
+    }
+
+    // every sampled word queries its own neighbours, like nn(word) does
+    typedef std::chrono::steady_clock clock;
+    std::chrono::duration<double, std::milli> exactTime(0);
+    std::chrono::duration<double, std::milli> approximateTime(0);
+    int64_t found = 0;
+    int64_t expected = 0;
+    Vector queryVec(args_->dim);
+    for (int32_t s = 0; s < evaluation.samples; s++) {
+        int32_t id = (int64_t) s * nwords / evaluation.samples;
+        std::set<int32_t> banSet = { id };
+        getVector(queryVec, dict_->getWord(id));
+
+        clock::time_point start = clock::now();
+        std::vector<PredictResult> exact = findNN(queryVec, k, banSet, threads);
+        clock::time_point middle = clock::now();
+        std::vector<std::pair<real, int32_t>> approximate =
+            index->search(queryVec, k, efSearch, banSet);
+        clock::time_point end = clock::now();
+        exactTime += middle - start;
+        approximateTime += end - middle;
+
+        std::set<std::string> exactWords;
+        for (auto& result : exact) {
+            exactWords.insert(result.label);
+        }
+        for (auto& result : approximate) {
+            found += exactWords.count(dict_->getWord(result.second));
+        }
+        expected += exact.size();
+    }
+
+    if (expected > 0) {
+        evaluation.recall = (double) found / expected;
+    }
+    evaluation.exactMs = exactTime.count() / evaluation.samples;
+    evaluation.approximateMs = approximateTime.count() / evaluation.samples;
+    return evaluation;
 }
 
 void Wrapper::loadVectors(std::string filename) {
@@ -220,28 +522,47 @@ void Wrapper::loadVectors(std::string filename) {
   }
 }
 
-std::vector<double> Wrapper::getSentenceVector(std::string sentence) {
-
+void Wrapper::getSentenceVector(Vector& svec, const std::string& sentence) {
+  getSentenceVector(svec, sentence.data(), sentence.size());
+}
 
-  Vector svec(args_->dim);
+void Wrapper::getSentenceVector(Vector& svec, const char* sentence,
+    size_t length) {
   svec.zero();
+  InferenceScratch& scratch = InferenceScratch::local();
   if (args_->model == model_name::sup) {
-    std::vector<int32_t> line, labels;
-    std::istringstream in(sentence);
-    dict_->getLine(in, line, labels, model_->rng);
-    for (int32_t i = 0; i < line.size(); i++) {
-      addInputVector(svec, line[i]);
-    }
-    if (!line.empty()) {
-      svec.mul(1.0 / line.size());
+    std::vector<int32_t>& line = scratch.words;
+    std::vector<int32_t>& labels = scratch.labels;
+    const SubwordTable* subwords = subwordTable();
+    if (subwords) {
+      dict_->getCompactLine(sentence, length, line, labels);
+      if (!line.empty()) {
+        svec.mul(1.0 / subwords->addLine(svec, line));
+      }
+    } else {
+      dict_->getLine(sentence, length, line, labels);
+      for (int32_t i = 0; i < line.size(); i++) {
+        addInputVector(svec, line[i]);
+      }
+      if (!line.empty()) {
+        svec.mul(1.0 / line.size());
+      }
     }
   } else {
-    Vector vec(args_->dim);
-    std::istringstream iss(sentence);
-    std::string word;
+    Vector& vec = scratch.vector(InferenceScratch::WORD, args_->dim);
+    const char* end = sentence + length;
     int32_t count = 0;
-    while (iss >> word) {
-      getWordVector(vec, word);
+    // words are split the way operator>> splits them, but read in place
+    for (const char* p = sentence; p < end;) {
+      if (isspace((unsigned char) *p)) {
+        p++;
+        continue;
+      }
+      const char* word = p;
+      while (p < end && !isspace((unsigned char) *p)) {
+        p++;
+      }
+      getWordVector(vec, word, p - word);
       real norm = vec.norm();
       if (norm > 0) {
         vec.mul(1.0 / norm);
@@ -253,11 +574,46 @@ std::vector<double> Wrapper::getSentenceVector(std::string sentence) {
       svec.mul(1.0 / count);
     }
   }
-  std::vector<double> result;
-  for(unsigned int i = 0; i < svec.size(); i++) {
-    result.push_back(svec[i]);
-  }
-  return result;
+}
+
+void Wrapper::sentenceVector(const char* sentence, size_t length, real* out,
+        const std::shared_ptr<ResultCache>& cache) {
+    const int32_t dim = args_->dim;
+    std::string key;
+    CachedResult cached;
+    if (cache) {
+        key = ResultCache::normalize(sentence, length);
+        if (cache->get(key, -1, 0.0, cached)) {
+            std::copy(cached.vector.begin(), cached.vector.end(), out);
+            return;
+        }
+    }
+    Vector& svec = InferenceScratch::local().vector(InferenceScratch::HIDDEN, dim);
+    getSentenceVector(svec, sentence, length);
+    std::copy(svec.data_, svec.data_ + dim, out);
+    if (cache) {
+        cached.vector.assign(svec.data_, svec.data_ + dim);
+        cache->put(key, -1, 0.0, cached);
+    }
+}
+
+void Wrapper::getSentenceVector(const char* sentence, size_t length,
+        real* out) {
+    sentenceVector(sentence, length, out, std::atomic_load(&cache_));
+}
+
+void Wrapper::getSentenceVectors(const std::vector<std::string>& sentences,
+        real* out, int32_t threads) {
+    int32_t n = sentences.size();
+    threads = std::max(1, std::min(threads, n));
+    const int32_t dim = args_->dim;
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&cache_);
+    parallelFor(threads, n, [&](int32_t, int32_t from, int32_t to) {
+        for (int32_t i = from; i < to; i++) {
+            sentenceVector(sentences[i].data(), sentences[i].size(),
+                out + (int64_t) i * dim, cache);
+        }
+    });
 }
 
 void Wrapper::addInputVector(Vector& vec, int32_t ind) const {
@@ -269,8 +625,20 @@ void Wrapper::addInputVector(Vector& vec, int32_t ind) const {
 }
 
 void Wrapper::getWordVector(Vector& vec, const std::string& word) const {
-  const std::vector<int32_t>& ngrams = dict_->getSubwords(word);
+  getWordVector(vec, word.data(), word.size());
+}
+
+void Wrapper::getWordVector(Vector& vec, const char* word, size_t length) const {
   vec.zero();
+  const SubwordTable* subwords = subwordTable();
+  int32_t id = subwords ? dict_->getId(word, length) : -1;
+  if (id >= 0) {
+    vec.mul(1.0 / subwords->addWord(vec, id));
+    return;
+  }
+  std::vector<int32_t>& ngrams = InferenceScratch::local().ngrams;
+  ngrams.clear();
+  dict_->getSubwords(word, length, ngrams);
   for (int i = 0; i < ngrams.size(); i ++) {
     addInputVector(vec, ngrams[i]);
   }
@@ -280,11 +648,7 @@ void Wrapper::getWordVector(Vector& vec, const std::string& word) const {
 }
 
 void Wrapper::trainThread(int32_t threadId) {
-  std::ifstream ifs(args_->input);
-  if (!ifs.is_open()) {
-      throw "Training data cannot be opened for loading!";
-  }
-  fasttext::utils::seek(ifs, threadId * fasttext::utils::size(ifs) / args_->thread);
+  fasttext::CorpusCursor cursor = corpus_->cursor(threadId, args_->thread);
 
   Model model(input_, output_, args_, threadId);
   if (args_->model == model_name::sup) {
@@ -297,17 +661,17 @@ void Wrapper::trainThread(int32_t threadId) {
   const int64_t ntokens = dict_->ntokens();
   int64_t localTokenCount = 0;
   std::vector<int32_t> line, labels;
-  while (tokenCount_ < args_->epoch * ntokens) {
+  while (tokenCount_ < args_->epoch * ntokens && !abortTraining_) {
     real progress = real(tokenCount_) / (args_->epoch * ntokens);
     real lr = args_->lr * (1.0 - progress);
     if (args_->model == model_name::sup) {
-      localTokenCount += dict_->getLine(ifs, line, labels, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, labels, model.rng);
       supervised(model, lr, line, labels);
     } else if (args_->model == model_name::cbow) {
-      localTokenCount += dict_->getLine(ifs, line, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, model.rng);
       cbow(model, lr, line);
     } else if (args_->model == model_name::sg) {
-      localTokenCount += dict_->getLine(ifs, line, model.rng);
+      localTokenCount += dict_->getLine(cursor, line, model.rng);
       skipgram(model, lr, line);
     }
     if (localTokenCount > args_->lrUpdateRate) {
@@ -316,7 +680,6 @@ void Wrapper::trainThread(int32_t threadId) {
       if (threadId == 0) loss_ = model.getLoss();
     }
   }
-  ifs.close();
 }
 
 void Wrapper::supervised(
@@ -361,12 +724,25 @@ void Wrapper::skipgram(Model& model, real lr,
   }
 }
 
-void Wrapper::train(const std::vector<std::string> args) {
+void Wrapper::train(const std::vector<std::string> args,
+        const std::function<void(const TrainProgress&)>& onProgress) {
     qinput_ = std::make_shared<QMatrix>();
     qoutput_ = std::make_shared<QMatrix>();
 
+    // the trained model is private to this wrapper
+    shared_.reset();
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&cache_);
+    if (cache) {
+        setCache(cache->maxBytes());
+    }
+    wordVectors_.reset();
+    index_.reset();
+    subwords_.reset();
+    quant_ = false;
     isLoaded_ = true;
-    isPrecomputed_ = true;
+    hasOutput_ = true;
+    isPrecomputed_ = false;
+    isSubwordsPrecomputed_ = false;
 
     // set up args
     args_ = std::make_shared<Args>();
@@ -379,13 +755,7 @@ void Wrapper::train(const std::vector<std::string> args) {
         // manage expectations
         throw std::invalid_argument("Cannot use stdin for training!");
     }
-    std::ifstream ifs(args_->input);
-    if (!ifs.is_open()) {
-        throw std::invalid_argument(
-            args_->input + " cannot be opened for training!");
-    }
-    dict_->readFromFile(ifs);
-    ifs.close();
+    dict_->readFromFile(args_->input);
 
     if (args_->pretrainedVectors.size() != 0) {
         loadVectors(args_->pretrainedVectors);
@@ -400,58 +770,282 @@ void Wrapper::train(const std::vector<std::string> args) {
         output_ = std::make_shared<Matrix>(dict_->nwords(), args_->dim);
     }
     output_->zero();
-    startThreads();
-    model_ = std::make_shared<Model>(input_, output_, args_, 0);
+    startThreads(onProgress);
+    // training is over: from now on the model is only read
+    model_ = std::make_shared<Model>(input_, output_, args_, 0, true);
     if (args_->model == model_name::sup) {
         model_->setTargetCounts(dict_->getCounts(entry_type::label));
     } else {
         model_->setTargetCounts(dict_->getCounts(entry_type::word));
     }
+    batcher_ = std::make_shared<PredictBatcher>(model_);
 }
 
-void Wrapper::startThreads() {
-  start_ = clock();
+void Wrapper::startThreads(
+        const std::function<void(const TrainProgress&)>& onProgress) {
+  start_ = std::chrono::steady_clock::now();
   tokenCount_ = 0;
   loss_ = -1;
+  corpus_ = std::make_shared<fasttext::Corpus>(args_->input);
+  if (args_->cacheCorpus) {
+    corpus_->cache(*dict_, args_->thread);
+  }
+  int32_t running = args_->thread;
+  std::exception_ptr error;
   std::vector<std::thread> threads;
   for (int32_t i = 0; i < args_->thread; i++) {
-    threads.push_back(std::thread([=]() { trainThread(i); }));
+    threads.push_back(std::thread([this, i, &running, &error]() {
+      std::exception_ptr thrown;
+      try {
+        trainThread(i);
+      } catch (...) {
+        thrown = std::current_exception();
+        // the others would wait for tokens this thread never counts
+        abortTraining_ = true;
+      }
+      std::lock_guard<std::mutex> lock(trainMtx_);
+      if (thrown && !error) {
+        error = thrown;
+      }
+      running--;
+      trainCv_.notify_all();
+    }));
   }
-  const int64_t ntokens = dict_->ntokens();
-  // Same condition as trainThread
-  while (tokenCount_ < args_->epoch * ntokens) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    // woken up by the last thread, not only by the next report
+    std::unique_lock<std::mutex> lock(trainMtx_);
+    while (!trainCv_.wait_for(lock, std::chrono::milliseconds(100),
+        [&running]() { return running == 0; })) {
+      if (onProgress) {
+        lock.unlock();
+        onProgress(trainProgress());
+        lock.lock();
+      }
+    }
   }
   for (int32_t i = 0; i < args_->thread; i++) {
     threads[i].join();
   }
+  corpus_.reset();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if (abortTraining_) {
+    throw std::runtime_error("Training was aborted!");
+  }
+  if (onProgress) {
+    onProgress(trainProgress());
+  }
+}
+
+TrainProgress Wrapper::trainProgress() const {
+  const int64_t total = args_->epoch * dict_->ntokens();
+  TrainProgress progress;
+  progress.tokens = std::min<int64_t>(tokenCount_, total);
+  progress.progress = total > 0 ? double(progress.tokens) / total : 1.0;
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+  progress.seconds = elapsed.count();
+  progress.wordsPerSecPerThread = progress.seconds > 0
+      ? progress.tokens / progress.seconds / args_->thread : 0.0;
+  progress.lr = args_->lr * (1.0 - progress.progress);
+  progress.loss = loss_;
+  return progress;
 }
 
-std::vector<PredictResult> Wrapper::predict (std::string sentence, int32_t k) {
+void Wrapper::abortTraining() {
+  abortTraining_ = true;
+}
 
-    std::vector<PredictResult> arr;
-    std::vector<int32_t> words, labels;
-    std::istringstream in(sentence);
+std::vector<PredictResult> Wrapper::predict (std::string sentence, int32_t k,
+        real threshold) {
+    return predict(sentence.data(), sentence.size(), k, threshold);
+}
 
-    dict_->getLine(in, words, labels, model_->rng);
+std::vector<PredictResult> Wrapper::predict (const char* sentence,
+        size_t length, int32_t k, real threshold) {
+    std::vector<PredictResult> predictions;
+    predict(sentence, length, k, predictions, threshold);
+    return predictions;
+}
 
-    // std::cerr << "Got line!" << std::endl;
+void Wrapper::predict (const char* sentence, size_t length, int32_t k,
+        std::vector<PredictResult>& out, real threshold) {
+    checkThreshold(threshold);
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&cache_);
+    std::string key;
+    CachedResult cached;
+    if (cache) {
+        key = ResultCache::normalize(sentence, length);
+        if (cache->get(key, k, threshold, cached)) {
+            out = cached.predictions;
+            return;
+        }
+    }
+
+    int32_t batchSize = batchSize_;
+    if (batcher_ && batchSize > 1) {
+        PredictBatcher::Arrival arrival(*batcher_, batchSize,
+            std::chrono::microseconds(batchWindowMicros_));
+        computePredictions(sentence, length, k, threshold, out, &arrival);
+    } else {
+        computePredictions(sentence, length, k, threshold, out);
+    }
+    if (cache) {
+        cached.predictions = out;
+        cache->put(key, k, threshold, cached);
+    }
+}
+
+PredictFileStats Wrapper::predictFile(const std::string& input, int32_t k,
+        real threshold, int32_t threads, int32_t chunkLines,
+        const std::function<void(PredictChunk&)>& sink) {
+    checkThreshold(threshold);
+    std::ifstream in(input, std::ifstream::binary);
+    if (!in.is_open()) {
+        throw std::invalid_argument(input + " cannot be opened for prediction!");
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PredictPipeline pipeline(threads, chunkLines);
+    int64_t lines = pipeline.run(in, [&](int32_t, PredictChunk& chunk) {
+        chunk.results.resize(chunk.lines.size());
+        for (size_t i = 0; i < chunk.lines.size(); i++) {
+            const std::string& line = chunk.lines[i];
+            computePredictions(line.data(), line.size(), k, threshold,
+                chunk.results[i]);
+        }
+    }, sink);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    PredictFileStats stats = { lines, elapsed.count(), 0.0 };
+    if (stats.seconds > 0) {
+        stats.linesPerSecond = lines / stats.seconds;
+    }
+    return stats;
+}
+
+PredictFileStats Wrapper::predictFile(const std::string& input,
+        const std::string& output, int32_t k, real threshold, int32_t threads,
+        int32_t chunkLines) {
+    std::ofstream out(output, std::ofstream::binary);
+    if (!out.is_open()) {
+        throw std::invalid_argument(output + " cannot be opened for saving!");
+    }
+    // same format as `fasttext predict-prob`
+    PredictFileStats stats = predictFile(input, k, threshold, threads, chunkLines,
+        [&out](PredictChunk& chunk) {
+            for (auto& predictions : chunk.results) {
+                for (auto it = predictions.cbegin(); it != predictions.cend(); it++) {
+                    if (it != predictions.cbegin()) {
+                        out << ' ';
+                    }
+                    out << it->label << ' ' << it->value;
+                }
+                out << '\n';
+            }
+            if (!out) {
+                throw std::runtime_error("Predictions cannot be written!");
+            }
+        });
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Predictions cannot be written!");
+    }
+    return stats;
+}
+
+void Wrapper::checkThreshold(real threshold) {
+    // also false for NaN
+    if (!(threshold >= 0 && threshold <= 1)) {
+        throw std::invalid_argument("threshold must be between 0 and 1!");
+    }
+}
+
+void Wrapper::setBatching(int32_t maxBatch, int64_t windowMicros) {
+    if (maxBatch < 1 || windowMicros < 0) {
+        throw std::invalid_argument("Invalid batching parameters!");
+    }
+    batchSize_ = maxBatch;
+    batchWindowMicros_ = windowMicros;
+}
+
+void Wrapper::computePredictions (const char* sentence, size_t length,
+        int32_t k, real threshold, std::vector<PredictResult>& out,
+        PredictBatcher::Arrival* arrival) {
+
+    InferenceScratch& scratch = InferenceScratch::local();
+    std::vector<int32_t>& words = scratch.words;
+    const SubwordTable* subwords = subwordTable();
+
+    if (subwords) {
+        dict_->getCompactLine(sentence, length, words, scratch.labels);
+    } else {
+        dict_->getLine(sentence, length, words, scratch.labels);
+    }
 
     if (words.empty()) {
-        return arr;
+        out.clear();
+        return;
     }
 
-    Vector hidden(args_->dim);
-    Vector output(dict_->nlabels());
-    std::vector<std::pair<real,int32_t>> modelPredictions;
-    model_->predict(words, k, modelPredictions, hidden, output);
+    Vector& hidden = scratch.vector(InferenceScratch::HIDDEN, args_->dim);
+    Vector& output = scratch.vector(InferenceScratch::OUTPUT, dict_->nlabels());
+    std::vector<std::pair<real,int32_t>>& modelPredictions = scratch.heap;
+    modelPredictions.clear();
+    if (subwords) {
+        hidden.zero();
+        hidden.mul(1.0 / subwords->addLine(hidden, words));
+    } else {
+        model_->computeHidden(words, hidden);
+    }
+    if (arrival) {
+        arrival->predict(k, modelPredictions, hidden, output, threshold);
+    } else {
+        model_->predict(k, modelPredictions, hidden, output, threshold);
+    }
 
-    PredictResult response;
+    // kept elements keep their strings, and so their capacity
+    out.resize(modelPredictions.size());
+    for (size_t i = 0; i < modelPredictions.size(); i++) {
+        out[i].label = dict_->getLabel(modelPredictions[i].second);
+        out[i].value = exp(modelPredictions[i].first);
+    }
+}
+
+std::vector<std::vector<PredictResult>> Wrapper::predictBatch (
+        const std::vector<std::string>& sentences, int32_t k, int32_t threads,
+        real threshold) {
+    checkThreshold(threshold);
 
-    for (auto it = modelPredictions.cbegin(); it != modelPredictions.cend(); it++) {
-        response = { dict_->getLabel(it->second), exp(it->first) };
-        arr.push_back(response);
+    std::vector<std::vector<PredictResult>> results(sentences.size());
+    int32_t n = sentences.size();
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > n) {
+        threads = n;
     }
 
-    return arr;
+    std::shared_ptr<ResultCache> cache = std::atomic_load(&cache_);
+    parallelFor(threads, n, [&](int32_t, int32_t from, int32_t to) {
+        CachedResult cached;
+        for (int32_t i = from; i < to; i++) {
+            if (!cache) {
+                computePredictions(sentences[i].data(), sentences[i].size(),
+                    k, threshold, results[i]);
+                continue;
+            }
+            std::string key = ResultCache::normalize(sentences[i]);
+            if (!cache->get(key, k, threshold, cached)) {
+                computePredictions(sentences[i].data(), sentences[i].size(),
+                    k, threshold, cached.predictions);
+                cache->put(key, k, threshold, cached);
+            }
+            results[i] = cached.predictions;
+        }
+    });
+    return results;
 }
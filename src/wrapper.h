@@ -6,11 +6,15 @@
 // #include <time.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <set>
 #include  <mutex>
 
 #include "../lib/src/fasttext.h"
+#include "modelRegistry.h"
 
 using fasttext::Args;
 using fasttext::Dictionary;
@@ -25,6 +29,54 @@ struct PredictResult {
     double value;
 };
 
+class ResultCache;
+struct CacheStats;
+
+// consecutive lines of a file, with their predictions once computed
+struct PredictChunk {
+    // index of the first line in the file
+    int64_t first;
+    std::vector<std::string> lines;
+    std::vector<std::vector<PredictResult>> results;
+};
+
+struct PredictFileStats {
+    int64_t lines;
+    double seconds;
+    double linesPerSecond;
+};
+
+struct IndexEvaluation {
+    int32_t samples;
+    // share of the exact neighbours also returned by the index
+    double recall;
+    // average time of one query, in milliseconds
+    double exactMs;
+    double approximateMs;
+};
+
+// where a training run stands, as fastText prints it
+struct TrainProgress {
+    // share of epoch * ntokens processed, from 0 to 1
+    double progress;
+    int64_t tokens;
+    double seconds;
+    double wordsPerSecPerThread;
+    real lr;
+    // average loss of the first thread, -1 until its first update
+    real loss;
+};
+
+/**
+ * A fastText model serving requests from any number of threads at once.
+ *
+ * Everything a request reads is assigned once, under a lock, before the
+ * flag saying it is ready is raised, and is never assigned again; the
+ * Model is inference-only and every per-call buffer lives in the calling
+ * thread's InferenceScratch. Inference therefore writes no shared state
+ * except the result cache and the batcher, which lock. train() is the
+ * exception: the addon runs it on a new Wrapper and swaps it in once done.
+ */
 class Wrapper {
     protected:
         std::shared_ptr<Args> args_;
@@ -37,20 +89,38 @@ class Wrapper {
         std::shared_ptr<QMatrix> qoutput_;
 
         std::shared_ptr<Model> model_;
-        Matrix wordVectors_;
+        // the training input, only while the training threads run
+        std::shared_ptr<fasttext::Corpus> corpus_;
+        std::shared_ptr<Matrix> wordVectors_;
+        std::shared_ptr<HnswIndex> index_;
+        std::shared_ptr<SubwordTable> subwords_;
+        std::shared_ptr<PredictBatcher> batcher_;
+        // results of this wrapper's model only, so a reload starts afresh
+        std::shared_ptr<ResultCache> cache_;
+
+        // set when the model comes from the registry, empty after train()
+        std::shared_ptr<SharedModel> shared_;
 
 
+        // predict() calls batched together at most, 1 to not batch
+        std::atomic<int32_t> batchSize_;
+        std::atomic<int64_t> batchWindowMicros_;
+
         std::atomic<int64_t> tokenCount_;
         std::atomic<real> loss_;
-        clock_t start_;
+        std::chrono::steady_clock::time_point start_;
+        // raised to stop the training threads before the last epoch
+        std::atomic<bool> abortTraining_;
+        std::mutex trainMtx_;
+        std::condition_variable trainCv_;
 
         void signModel(std::ostream&);
-        bool checkModel(std::istream&);
 
         std::vector<PredictResult> findNN(const Vector&, int32_t,
-                    const std::set<std::string>&);
+                    const std::set<int32_t>&, int32_t);
 
-        void loadModel(std::istream&);
+        std::shared_ptr<Matrix> computeWordVectors();
+        std::shared_ptr<HnswIndex> loadIndex(int32_t threads);
         void loadVectors(std::string);
         void trainThread(int32_t);
 
@@ -66,26 +136,123 @@ class Wrapper {
         std::string modelFilename_;
         std::mutex mtx_;
         std::mutex precomputeMtx_;
+        std::mutex indexMtx_;
+
+        std::atomic<bool> isLoaded_;
+        std::atomic<bool> hasOutput_;
+        std::atomic<bool> isPrecomputed_;
+        std::atomic<bool> isSubwordsPrecomputed_;
+        std::atomic<bool> useSubwordTable_;
 
-        bool isLoaded_;
-        bool isPrecomputed_;
+        // runs the training threads, reporting progress every interval
+        // until the last one is done
+        void startThreads(const std::function<void(const TrainProgress&)>&);
+        TrainProgress trainProgress() const;
 
-        void startThreads();
+        // the subword table once precomputeSubwords() is over, nullptr
+        // before or when it is turned off: requests racing with it never
+        // see a half set pointer
+        const SubwordTable* subwordTable() const {
+            return useSubwordTable_ && isSubwordsPrecomputed_ ?
+                subwords_.get() : nullptr;
+        }
+
+        // tokenizes and predicts on the thread's InferenceScratch, without
+        // the cache
+        void computePredictions(const char*, size_t, int32_t, real,
+                    std::vector<PredictResult>&,
+                    PredictBatcher::Arrival* = nullptr);
+        void sentenceVector(const char*, size_t, real* out,
+                    const std::shared_ptr<ResultCache>&);
+        static void checkThreshold(real);
     public:
         Wrapper(std::string modelFilename);
 
         void getVector(Vector&, const std::string&);
 
-        std::vector<PredictResult> predict(std::string sentence, int32_t k);
-        std::vector<PredictResult> nn(std::string query, int32_t k);
+        // the k most likely labels, leaving out those of a probability
+        // below the threshold
+        std::vector<PredictResult> predict(std::string sentence, int32_t k,
+                    real threshold = 0.0);
+        // the sentence as raw UTF-8 bytes, e.g. straight from a Node Buffer
+        std::vector<PredictResult> predict(const char* sentence, size_t length,
+                    int32_t k, real threshold = 0.0);
+        // same, into `out`: the labels reuse its strings, so a caller keeping
+        // `out` across calls predicts without allocating once the cache is off
+        void predict(const char* sentence, size_t length, int32_t k,
+                    std::vector<PredictResult>& out, real threshold = 0.0);
+        // predicts every line of the input file with `threads` workers, and
+        // hands the results to the sink in file order, chunkLines at a time
+        PredictFileStats predictFile(const std::string& input, int32_t k,
+                    real threshold, int32_t threads, int32_t chunkLines,
+                    const std::function<void(PredictChunk&)>& sink);
+        // same, writing one line of "label probability..." per input line
+        PredictFileStats predictFile(const std::string& input,
+                    const std::string& output, int32_t k, real threshold,
+                    int32_t threads, int32_t chunkLines);
+        // lets concurrent predict() calls on the same model share one pass
+        // over the output matrix: up to maxBatch calls, gathered for at most
+        // windowMicros
+        void setBatching(int32_t maxBatch, int64_t windowMicros);
+        std::vector<std::vector<PredictResult>> predictBatch(
+                    const std::vector<std::string>& sentences, int32_t k,
+                    int32_t threads, real threshold = 0.0);
+        std::vector<PredictResult> nn(std::string query, int32_t k,
+                    int32_t threads = 1);
+        std::vector<PredictResult> approximateNn(std::string query, int32_t k,
+                    int32_t efSearch, int32_t threads = 1);
+
+        void buildIndex(int32_t M, int32_t efConstruction, int32_t threads);
+        IndexEvaluation evaluateIndex(int32_t samples, int32_t k,
+                    int32_t efSearch, int32_t threads);
 
-        void train(const std::vector<std::string> args);
+        // args as for the fastText CLI, the command first. onProgress is
+        // called on the thread that called train(), never on one of the
+        // training threads, every 100ms and once at the end
+        void train(const std::vector<std::string> args,
+                    const std::function<void(const TrainProgress&)>& onProgress = nullptr);
+        // makes the running train() stop early and throw, or the next one
+        // if none is running; callable from any thread
+        void abortTraining();
+        // writes the model in the .bin format, or page aligned as mapModel
+        // does; readers of filename see either the old file or the new one
+        void saveModel(const std::string& filename, bool mapped = false);
 
         void precomputeWordVectors();
-        void loadModel();
+        // makes predictions and word vectors add one row per known word,
+        // once setSubwordTable(true) was called, and does nothing otherwise
+        void precomputeSubwords();
+        // off by default: the table takes nwords x dim more floats, and the
+        // vector of several words is summed in another order, so it can
+        // differ from the one without the table by float rounding
+        void setSubwordTable(bool enabled);
+        bool usesSubwordTable() const { return useSubwordTable_; }
+        // withOutput false is enough for nn and sentence vectors, it skips
+        // the output matrix until a prediction needs it
+        void loadModel(bool withOutput = true);
+
+        // does now what the first request would do lazily: loads the model,
+        // builds the caches and faults the matrices in. predictions false
+        // prepares for nn and vectors instead
+        void warmUp(bool predictions);
+        // caches the results of predict and sentence vectors within maxBytes,
+        // 0 turns the cache off
+        void setCache(int64_t maxBytes);
+        CacheStats cacheStats() const;
+        // takes over the runtime settings of the wrapper it replaces
+        void copySettings(const Wrapper&);
 
-        std::vector<double> getSentenceVector(std::string);
+        int32_t getDimension() const { return args_->dim; }
+        const std::string& getModelFilename() const { return modelFilename_; }
+        void getSentenceVector(Vector&, const std::string&);
+        void getSentenceVector(Vector&, const char*, size_t);
+        // writes getDimension() values to out
+        void getSentenceVector(const char* sentence, size_t length, real* out);
+        // writes sentences.size() rows of getDimension() values to out
+        void getSentenceVectors(const std::vector<std::string>& sentences,
+                    real* out, int32_t threads);
         void getWordVector(Vector&, const std::string&) const;
+        void getWordVector(Vector&, const char*, size_t) const;
         void addInputVector(Vector&, int32_t) const;
 
 };
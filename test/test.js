@@ -4,8 +4,10 @@
 'use strict';
 
 const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
 const path = require('path');
-const { Classifier, Query } = require('../main');
+const { Classifier, Query, mapModel } = require('../main');
 
 describe('<Classifier>', function () {
 
@@ -51,6 +53,324 @@ describe('<Classifier>', function () {
         });
     });
 
+    it('should share one model between instances', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const a = new Classifier(model);
+        const b = new Classifier(path.join(__dirname, '..', 'test', 'query.bin'));
+
+        a.predict('how it works', 1, (err, resA) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            b.predict('how it works', 1, (e, resB) => {
+                if (e) {
+                    done(e);
+                    return;
+                }
+                assert.deepStrictEqual(resB, resA);
+                done();
+            });
+        });
+    });
+
+    it('should predict from a memory mapped model', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+        const mapped = path.join(os.tmpdir(), `fast-text-${process.pid}.mmap`);
+
+        mapModel(model, mapped, (err) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            const c = new Classifier(mapped);
+
+            c.predict('how it works', 1, (e, res) => {
+                fs.unlinkSync(mapped);
+                if (e) {
+                    done(e);
+                    return;
+                }
+                assert.strictEqual(res.length, 1);
+                assert.equal(res[0].label, '__label__helloLabel');
+                done();
+            });
+        });
+    });
+
+    it('#predictBatch()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+
+        c.predictBatch(['how it works', 'wtf', 'how it works'], 1, 2, (err, res) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            assert.equal(Array.isArray(res), true, 'res should be an array');
+            assert.strictEqual(res.length, 3);
+            assert.strictEqual(res[0].length, 1);
+            assert.equal(res[0][0].label, '__label__helloLabel');
+            assert.deepStrictEqual(res[2], res[0]);
+            done();
+        });
+    });
+
+    it('#predictFile()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+        const input = path.join(os.tmpdir(), `predict-${process.pid}.txt`);
+        const output = `${input}.out`;
+        fs.writeFileSync(input, 'how it works\nwtf\nhow it works\n');
+
+        const c = new Classifier(model);
+        const chunks = [];
+
+        assert.throws(() => c.predictFile(input, 1, { output, onChunk: () => {} }, () => {}), /not both/);
+        c.predictFile(input, 1, { chunkSize: 2, onChunk: (res, first) => chunks.push([first, res]) }, (err, stats) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            assert.strictEqual(stats.lines, 3);
+            assert.deepStrictEqual(chunks.map(([first, res]) => [first, res.length]), [[0, 2], [2, 1]]);
+            assert.equal(chunks[0][1][0][0].label, '__label__helloLabel');
+            assert.deepStrictEqual(chunks[1][1][0], chunks[0][1][0]);
+
+            c.predictFile(input, 1, { threads: 2, output }, (err2, stats2) => {
+                if (err2) {
+                    done(err2);
+                    return;
+                }
+                const lines = fs.readFileSync(output, 'utf8').split('\n');
+                fs.unlinkSync(input);
+                fs.unlinkSync(output);
+                assert.strictEqual(stats2.lines, 3);
+                assert.strictEqual(lines.length, 4);
+                assert.equal(lines[0].split(' ')[0], '__label__helloLabel');
+                assert.strictEqual(lines[2], lines[0]);
+                done();
+            });
+        });
+    });
+
+    it('#predictFile() with more chunks than are kept in flight', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+        const input = path.join(os.tmpdir(), `predict-many-${process.pid}.txt`);
+        fs.writeFileSync(input, 'how it works\n'.repeat(200));
+
+        const c = new Classifier(model);
+        let next = 0;
+
+        c.predictFile(input, 1, { threads: 2, chunkSize: 1, onChunk: (res, first) => {
+            assert.strictEqual(first, next);
+            next += res.length;
+        } }, (err, stats) => {
+            fs.unlinkSync(input);
+            if (err) {
+                done(err);
+                return;
+            }
+            assert.strictEqual(stats.lines, 200);
+            assert.strictEqual(next, 200);
+            done();
+        });
+    });
+    it('#load() and #reload()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+
+        c.load((err) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            c.predict('how it works', 1, (err2, before) => {
+                c.reload(model, { warmUp: false }, (err3) => {
+                    if (err3) {
+                        done(err3);
+                        return;
+                    }
+                    c.predict('how it works', 1, (err4, after) => {
+                        assert.deepStrictEqual(after, before);
+                        c.reload('/nonexistent.bin', (err5) => {
+                            assert.ok(err5 instanceof Error);
+                            c.predict('how it works', 1, (err6, kept) => {
+                                assert.deepStrictEqual(kept, before);
+                                done(err2 || err4 || err6);
+                            });
+                        });
+                    });
+                });
+            });
+        });
+    });
+
+    it('#load() with a subword table', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+
+        c.predict('how it works', 1, (err, without) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            c.load({ subwordTable: true }, (err2) => {
+                if (err2) {
+                    done(err2);
+                    return;
+                }
+                c.predict('how it works', 1, (err3, withTable) => {
+                    if (err3) {
+                        done(err3);
+                        return;
+                    }
+                    assert.strictEqual(withTable[0].label, without[0].label);
+                    assert.ok(Math.abs(withTable[0].value - without[0].value) < 1e-5);
+                    done();
+                });
+            });
+        });
+    });
+
+    it('#setCache()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+        c.setCache({ maxBytes: 1024 * 1024 });
+
+        c.predict('how it works', 1, (err, first) => {
+            c.predict(' how  it works ', 1, (err2, second) => {
+                if (err || err2) {
+                    done(err || err2);
+                    return;
+                }
+                assert.deepStrictEqual(second, first);
+                const stats = c.cacheStats();
+                assert.strictEqual(stats.hits, 1);
+                assert.strictEqual(stats.misses, 1);
+                assert.strictEqual(stats.hitRate, 0.5);
+                assert.strictEqual(stats.entries, 1);
+                c.setCache({ maxBytes: 0 });
+                assert.strictEqual(c.cacheStats().entries, 0);
+                done();
+            });
+        });
+    });
+
+    it('should predict from a Buffer', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+
+        c.predict('how it works', 2, (err, expected) => {
+            c.predict(Buffer.from('how it works'), 2, (err2, res) => {
+                if (err || err2) {
+                    done(err || err2);
+                    return;
+                }
+                assert.deepStrictEqual(res, expected);
+                done();
+            });
+        });
+    });
+
+    it('#train()', function (done) {
+        const input = path.resolve(__dirname, './classification.txt');
+        const output = path.resolve(__dirname, './classification-out');
+
+        const c = new Classifier(input);
+        const progress = [];
+
+        c.train({ input, output, epoch: 50, dictThreads: 2 }, (p) => { progress.push(p); }, (err) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            assert.ok(progress.length > 0, 'progress should be reported');
+            assert.strictEqual(progress[progress.length - 1].progress, 1);
+            assert.strictEqual(typeof progress[0].wordsPerSecPerThread, 'number');
+            c.predict('this is how it works', 1, (err2, res) => {
+                if (err2) {
+                    done(err2);
+                    return;
+                }
+                assert.equal(res[0].label, '__label__helloLabel');
+                c.saveModel(`${output}.bin`, (err3) => {
+                    if (err3) {
+                        done(err3);
+                        return;
+                    }
+                    const saved = new Classifier(`${output}.bin`);
+                    saved.predict('this is how it works', 1, (err4, res2) => {
+                        fs.unlinkSync(`${output}.bin`);
+                        if (err4) {
+                            done(err4);
+                            return;
+                        }
+                        assert.deepStrictEqual(res2, res);
+                        done();
+                    });
+                });
+            });
+        });
+    });
+
+    it('should predict with a threshold', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+
+        c.predict('how it works', 2, 0, (err, expected) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            const threshold = expected[0].value / 2;
+            c.predict('how it works', 2, threshold, (err2, res) => {
+                if (err2) {
+                    done(err2);
+                    return;
+                }
+                assert.deepStrictEqual(res[0], expected[0]);
+                assert.ok(res.every((r) => r.value >= threshold));
+                c.predictBatch(['how it works'], 2, { threshold }, (err3, batch) => {
+                    if (err3) {
+                        done(err3);
+                        return;
+                    }
+                    assert.deepStrictEqual(batch[0], res);
+                    c.predict('how it works', 2, 2, (err4) => {
+                        assert.ok(err4, 'a threshold above 1 should fail');
+                        done();
+                    });
+                });
+            });
+        });
+    });
+
+    it('#setBatching()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Classifier(model);
+        c.setBatching({ maxBatch: 8, window: 1000 });
+
+        const sentences = ['how it works', 'wtf', 'how it works', 'wtf'];
+        Promise.all(sentences.map((sentence) => new Promise((resolve, reject) => {
+            c.predict(sentence, 1, (err, res) => err ? reject(err) : resolve(res));
+        }))).then((res) => {
+            assert.strictEqual(res.length, 4);
+            assert.equal(res[0][0].label, '__label__helloLabel');
+            assert.deepStrictEqual(res[2], res[0]);
+            assert.deepStrictEqual(res[3], res[1]);
+            assert.throws(() => c.setBatching({ maxBatch: 0 }));
+            done();
+        }).catch(done);
+    });
+
 });
 
 describe('<Query>', function () {
@@ -79,6 +399,86 @@ describe('<Query>', function () {
         });
     });
 
+    it('should return the same neighbors with several threads', function (done) {
+
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Query(model);
+
+        c.nn('wozniak', 5, (err, single) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            c.nn('wozniak', 5, 4, (err, res) => {
+                if (err) {
+                    done(err);
+                    return;
+                }
+                assert.deepEqual(res, single);
+                assert.equal(res.some((v) => v.label === 'wozniak'), false, 'query word should be excluded');
+                done();
+            });
+        });
+    });
+
+    it('should answer concurrent requests like sequential ones', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+        const words = ['wozniak', 'hello', 'boy', 'frog', 'green', 'guy'];
+
+        const run = (q, word) => Promise.all([
+            new Promise((resolve, reject) => q.nn(word, 3, (err, res) => err ? reject(err) : resolve(res))),
+            new Promise((resolve, reject) => q.getSentenceVector(word + ' is here', (err, res) => err ? reject(err) : resolve(Array.from(res)))),
+        ]);
+
+        // requests all start before the model is loaded
+        const concurrent = new Query(model);
+        const sequential = new Query(model);
+        Promise.all(words.map((word) => run(concurrent, word))).then((all) => {
+            return words.reduce((p, word, i) => p.then(() => run(sequential, word)).then((res) => {
+                assert.deepStrictEqual(all[i], res);
+            }), Promise.resolve());
+        }).then(() => done()).catch(done);
+    });
+
+    it('should search neighbors with an approximate index', function (done) {
+        // the index is saved next to the model, so work on a copy
+        const model = path.join(os.tmpdir(), `fast-text-${process.pid}.bin`);
+        fs.copyFileSync(path.resolve(__dirname, './query.bin'), model);
+
+        const finish = (err) => {
+            [model, `${model}.hnsw`].filter((f) => fs.existsSync(f)).forEach((f) => fs.unlinkSync(f));
+            done(err);
+        };
+
+        const c = new Query(model);
+
+        c.buildIndex({ M: 8, efConstruction: 50 }, (err) => {
+            if (err) {
+                finish(err);
+                return;
+            }
+            assert.strictEqual(fs.existsSync(`${model}.hnsw`), true, 'index should be saved');
+
+            c.nn('wozniak', 2, { approximate: true, efSearch: 32 }, (err, res) => {
+                if (err) {
+                    finish(err);
+                    return;
+                }
+                assert.strictEqual(res.length, 2);
+                c.evaluateIndex({ samples: 20, k: 2 }, (err, evaluation) => {
+                    if (err) {
+                        finish(err);
+                        return;
+                    }
+                    assert.equal(typeof evaluation.recall, 'number');
+                    assert.ok(evaluation.recall > 0.5);
+                    finish();
+                });
+            });
+        });
+    });
+
     it('#getSentenceVector()', function (done) {
         const model = path.resolve(__dirname, './query.bin');
 
@@ -89,12 +489,39 @@ describe('<Query>', function () {
                 done(err);
                 return;
             }
-            assert.equal(Array.isArray(res), true, 'res should be an array');
+            assert.equal(res instanceof Float32Array, true, 'res should be a Float32Array');
             assert.strictEqual(res.length, 200);
-            res.forEach((v) => {
-                assert.equal(typeof v, 'number');
-            })
-            done();
+            c.getSentenceVector(Buffer.from('wozniak hello'), (err2, res2) => {
+                if (err2) {
+                    done(err2);
+                    return;
+                }
+                assert.deepStrictEqual(res2, res);
+                done();
+            });
+        });
+    });
+
+    it('#getSentenceVectors()', function (done) {
+        const model = path.resolve(__dirname, './query.bin');
+
+        const c = new Query(model);
+
+        c.getSentenceVector('wozniak hello', (err, single) => {
+            if (err) {
+                done(err);
+                return;
+            }
+            c.getSentenceVectors(['how it works', 'wozniak hello'], 2, (err, res) => {
+                if (err) {
+                    done(err);
+                    return;
+                }
+                assert.equal(res instanceof Float32Array, true, 'res should be a Float32Array');
+                assert.strictEqual(res.length, 2 * 200);
+                assert.deepStrictEqual(res.subarray(200), single);
+                done();
+            });
         });
     });
 
@@ -118,14 +545,45 @@ describe('<Query>', function () {
                     done(err);
                     return;
                 }
-                assert.equal(Array.isArray(res), true, 'res should be an array');
+                assert.equal(res instanceof Float32Array, true, 'res should be a Float32Array');
                 assert.strictEqual(res.length, 100);
-                res.forEach((v) => {
-                    assert.equal(typeof v, 'number');
-                })
                 done();
             });
         });
     });
 
+    it('#train() with a cached corpus', function (done) {
+        const input = path.resolve(__dirname, './texts.txt');
+        const output = path.resolve(__dirname, './texts-out.txt');
+
+        const train = (cacheCorpus) => new Promise((resolve, reject) => {
+            const c = new Query(input);
+            c.train({ dim: 10, output, input, thread: 1, cacheCorpus }, (err) => {
+                if (err) {
+                    reject(err);
+                    return;
+                }
+                c.getSentenceVector('is frog brown', (e, res) => e ? reject(e) : resolve(res));
+            });
+        });
+
+        // with one thread the cache only changes where the tokens come from
+        train(false).then((uncached) => train(true).then((cached) => {
+            assert.deepStrictEqual(cached, uncached);
+        })).then(() => done()).catch(done);
+    });
+
+    it('#train() with cbow and an abort', function (done) {
+        const input = path.resolve(__dirname, './texts.txt');
+        const output = path.resolve(__dirname, './texts-out.txt');
+
+        const c = new Query(input);
+
+        c.train({ dim: 10, output, input, model: 'cbow', epoch: 10000000 }, () => false, (err) => {
+            assert.ok(err, 'training should have been aborted');
+            assert.throws(() => c.train({ input, output, model: 'glove' }, () => {}));
+            done();
+        });
+    });
+
 });
\ No newline at end of file